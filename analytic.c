@@ -0,0 +1,243 @@
+#include "analytic.h"
+#include "table.h"
+
+/**
+*@brief Probabilite que team1, placee en equipe 1, batte team2. Les chances ne dependant que de l'ecart de classement, chaque ecart n'est calcule qu'une fois, a la premiere demande.
+*@param a Les probabilites du tableau.
+*@param team1 Numero de l'equipe 1.
+*@param team2 Numero de l'equipe 2.
+*@return La probabilite de victoire de l'equipe 1.
+*/
+static double analytic_win(Analytic *a, int team1, int team2) {
+    double *w = &a->win[rating_diff(team1, team2) + RATING_MAX_DIFF];
+    if (*w < 0) {
+        Odds odds;
+        odds_from_diff(rating_diff(team1, team2), &odds);
+        *w = table_win_probability(&odds);
+    }
+    return *w;
+}
+
+/**
+*@brief Recalcule les probabilites du match k du tour r a partir du tour precedent : chaque equipe d'une moitie doit avoir atteint ce tour, puis battre l'equipe arrivee de l'autre moitie. Chaque paire d'equipes est evaluee une seule fois, pour les deux cotes.
+*@param a Les probabilites du tableau.
+*@param r Le tour, de 1 a num_rounds.
+*@param k L'indice du match dans le tour.
+*@return vide.
+*/
+static void analytic_match(Analytic *a, int r, int k) {
+    int half = 1 << (r - 1);
+    int first = k << r;
+    int id = a->size - (a->size >> (r - 1)) + k;
+    double *prev = &a->reach[(size_t) (r - 1) * a->size];
+    double *cur = &a->reach[(size_t) r * a->size];
+    double mass = 0;
+
+    //Resultat connu : le vainqueur est certain, les autres equipes sont eliminees
+    if (a->locked[id] >= 0) {
+        for (int p = first; p < first + 2 * half; p++) {
+            cur[p] = a->slots[p] == a->locked[id] ? 1 : 0;
+        }
+        return;
+    }
+    for (int q = first + half; q < first + 2 * half; q++) {
+        mass += prev[q];
+        cur[q] = 0;
+    }
+    //Exemption : l'equipe 1 passe sans jouer
+    if (mass == 0) {
+        for (int p = first; p < first + half; p++) {
+            cur[p] = prev[p];
+        }
+        return;
+    }
+    for (int p = first; p < first + half; p++) {
+        double beat = 0;
+        if (prev[p] == 0) {
+            cur[p] = 0;
+            continue;
+        }
+        for (int q = first + half; q < first + 2 * half; q++) {
+            if (prev[q] > 0) {
+                double w = analytic_win(a, a->slots[p], a->slots[q]);
+                beat += prev[q] * w;
+                cur[q] += prev[p] * (1 - w);
+            }
+        }
+        cur[p] = prev[p] * beat;
+    }
+    for (int q = first + half; q < first + 2 * half; q++) {
+        cur[q] *= prev[q];
+    }
+}
+
+/**
+*@brief Calcule les probabilites exactes d'un tableau donne par ses places du premier tour, tour par tour, avant tout match joue.
+*@param a Les probabilites a initialiser.
+*@param size Le nombre de places, une puissance de 2.
+*@param slots L'equipe de chaque place, -1 pour une exemption (voir bracket_slots).
+*@return vide.
+*/
+void analytic_setup(Analytic *a, int size, const int *slots) {
+    a->size = size;
+    a->num_rounds = 0;
+    while ((1 << a->num_rounds) < a->size) {
+        a->num_rounds++;
+    }
+    a->slots = (int*) malloc(a->size * sizeof(int));
+    a->locked = (int*) malloc((a->size - 1) * sizeof(int));
+    a->reach = (double*) malloc((size_t) (a->num_rounds + 1) * a->size * sizeof(double));
+    a->win = (double*) malloc((2 * RATING_MAX_DIFF + 1) * sizeof(double));
+    for (int i = 0; i < 2 * RATING_MAX_DIFF + 1; i++) {
+        a->win[i] = -1; // pas encore calcule
+    }
+    for (int i = 0; i < a->size - 1; i++) {
+        a->locked[i] = -1;
+    }
+    memcpy(a->slots, slots, a->size * sizeof(int));
+    for (int p = 0; p < a->size; p++) {
+        a->reach[p] = a->slots[p] >= 0 ? 1 : 0;
+    }
+    for (int r = 1; r <= a->num_rounds; r++) {
+        for (int k = 0; k < a->size >> r; k++) {
+            analytic_match(a, r, k);
+        }
+    }
+}
+
+/**
+*@brief Calcule les probabilites exactes du tableau prepare par bracket_init, avant tout match joue.
+*@param a Les probabilites a initialiser.
+*@param b Le tableau du tournoi, dont seul le premier tour est lu.
+*@return vide.
+*/
+void analytic_init(Analytic *a, Bracket *b) {
+    int size = b->num_matchs + 1;
+    int *slots = (int*) malloc(size * sizeof(int));
+
+    for (int i = 0; i < size / 2; i++) {
+        slots[2 * i] = b->matchs[i].team1;
+        slots[2 * i + 1] = b->matchs[i].team2;
+    }
+    analytic_setup(a, size, slots);
+    free(slots);
+}
+
+/**
+*@brief Fige le resultat d'un match et met a jour les probabilites : seuls ce match et ses ancetres jusqu'a la finale sont recalcules, les autres sous-arbres ne changeant pas.
+*@param a Les probabilites du tableau.
+*@param id L'indice du match dans le Bracket.
+*@param winner Le numero de l'equipe gagnante.
+*@return vide.
+*/
+void analytic_lock(Analytic *a, int id, int winner) {
+    int r = 1;
+    int k = id;
+    while (k >= a->size >> r) { // indice dans le tour r
+        k -= a->size >> r;
+        r++;
+    }
+    a->locked[id] = winner;
+    for (; r <= a->num_rounds; r++, k /= 2) {
+        analytic_match(a, r, k);
+    }
+}
+
+/**
+ *@brief Probabilites dont les places sont en cours de tri dans analytic_order
+*/
+static Analytic *sorted;
+
+/**
+*@brief Compare deux places par probabilite de titre decroissante, puis par numero d'equipe.
+*@param a Pointeur sur la premiere place.
+*@param b Pointeur sur la seconde place.
+*@return Un entier negatif, nul ou positif, comme pour qsort.
+*/
+static int compare_titles(const void *a, const void *b) {
+    int pa = *(const int*) a;
+    int pb = *(const int*) b;
+    double wa = sorted->reach[(size_t) sorted->num_rounds * sorted->size + pa];
+    double wb = sorted->reach[(size_t) sorted->num_rounds * sorted->size + pb];
+    if (wa != wb) {
+        return wa < wb ? 1 : -1;
+    }
+    return sorted->slots[pa] - sorted->slots[pb];
+}
+
+/**
+*@brief Range les places occupees par une equipe par probabilite de titre decroissante.
+*@param a Les probabilites du tableau.
+*@param order Le tableau a remplir, d'au moins size places.
+*@return Le nombre d'equipes.
+*/
+static int analytic_order(Analytic *a, int *order) {
+    int count = 0;
+    for (int p = 0; p < a->size; p++) {
+        if (a->slots[p] >= 0) {
+            order[count++] = p;
+        }
+    }
+    sorted = a;
+    qsort(order, count, sizeof(int), compare_titles);
+    return count;
+}
+
+/**
+*@brief Affiche, pour chaque equipe, la probabilite exacte d'atteindre chaque tour et de remporter le tournoi, dans le meme format que montecarlo_print.
+*@param a Les probabilites du tableau.
+*@param out La destination de la table.
+*@return vide.
+*/
+void analytic_print(Analytic *a, FILE *out) {
+    int *order = (int*) malloc(a->size * sizeof(int));
+    int count = analytic_order(a, order);
+
+    fprintf(out, "%-25s", "Equipe");
+    for (int r = 2; r <= a->num_rounds; r++) {
+        fprintf(out, " Tour %-3d", r);
+    }
+    fprintf(out, " Vainqueur\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%-25.*s", TEAM_MAX(a->slots[order[i]], 25));
+        for (int r = 1; r <= a->num_rounds; r++) {
+            fprintf(out, " %7.3f%%", 100.0 * a->reach[(size_t) r * a->size + order[i]]);
+        }
+        fprintf(out, "\n");
+    }
+    free(order);
+}
+
+/**
+*@brief Affiche sur une ligne les equipes les plus probables vainqueurs du tournoi, parmi celles encore en course.
+*@param a Les probabilites du tableau.
+*@param count Le nombre maximal d'equipes affichees.
+*@return vide.
+*/
+void analytic_print_top(Analytic *a, int count) {
+    int *order = (int*) malloc(a->size * sizeof(int));
+    int n = analytic_order(a, order);
+
+    printf("PRONOSTIC");
+    for (int i = 0; i < n && i < count; i++) {
+        double title = a->reach[(size_t) a->num_rounds * a->size + order[i]];
+        if (title <= 0) {
+            break;
+        }
+        printf("%s%.*s %.1f%%", i > 0 ? " | " : " ", TEAM_MAX(a->slots[order[i]], 20), 100.0 * title);
+    }
+    printf("\n");
+    free(order);
+}
+
+/**
+*@brief Libere les probabilites du tableau.
+*@param a Les probabilites du tableau.
+*@return vide.
+*/
+void analytic_free(Analytic *a) {
+    free(a->win);
+    free(a->reach);
+    free(a->locked);
+    free(a->slots);
+}
@@ -0,0 +1,31 @@
+#ifndef OS_ANALYTIC_H
+#define OS_ANALYTIC_H
+
+#include "fonctions.h"
+#include "bracket.h"
+
+/**
+ *@brief Probabilites exactes du tableau, calculees par programmation dynamique sur l'arbre du tournoi (sans tirage aleatoire).
+ * Les places du premier tour sont numerotees de 0 a size - 1 comme dans bracket_slots ; le match k du tour r
+ * oppose les places [k * 2^r, k * 2^r + 2^(r-1)) (equipe 1) aux places [k * 2^r + 2^(r-1), (k + 1) * 2^r) (equipe 2).
+ * reach[r * size + p] est la probabilite que l'equipe de la place p gagne ses r premiers matchs, donc atteigne le tour r + 1 ;
+ * la ligne r = num_rounds donne les probabilites de titre. Le calcul complet coute O(size^2) evaluations de win.
+ * Un match dont le resultat est connu est fige (analytic_lock) : seuls ce match et ses ancetres sont recalcules.
+*/
+typedef struct Analytic{
+    int size;           // places du premier tour, exemptions comprises
+    int num_rounds;     // nombre de tours, log2(size)
+    int *slots;         // equipe de chaque place, -1 pour une exemption
+    int *locked;        // vainqueur connu de chaque match du Bracket, -1 si le match n'est pas joue
+    double *reach;      // (num_rounds + 1) * size probabilites
+    double *win;        // probabilite de victoire de l'equipe 1 pour chaque ecart de classement, indice diff + RATING_MAX_DIFF
+}Analytic;
+
+void analytic_setup(Analytic *a, int size, const int *slots);
+void analytic_init(Analytic *a, Bracket *b);
+void analytic_lock(Analytic *a, int id, int winner);
+void analytic_print(Analytic *a, FILE *out);
+void analytic_print_top(Analytic *a, int count);
+void analytic_free(Analytic *a);
+
+#endif
@@ -0,0 +1,473 @@
+#include "batch.h"
+#include <stdlib.h>
+#include <immintrin.h>
+
+/**
+ *@brief Seuils de but sur un tirage de 32 bits : l'equipe 1 marque si u < GOAL1, l'equipe 2 si GOAL1 <= u < GOAL2 (1% chacune, comme rng_below(100) dans regulation_minute)
+*/
+#define GOAL1 42949673u
+#define GOAL2 (2 * GOAL1)
+
+/**
+ *@brief Seuils des tirs au but sans classement : exactement rng_below(100) > 20 pour l'equipe 1 et rng_below(100) < 40 pour l'equipe 2
+*/
+#define MISS1 901943133u
+#define HIT2 1717986919u
+
+/**
+ *@brief Jeu d'instructions retenu par batch_detect, modifiable pour forcer un chemin
+*/
+BatchIsa batch_isa = BATCH_SCALAR;
+
+/**
+*@brief Choisit le meilleur chemin disponible sur le processeur courant.
+*@return Le jeu d'instructions retenu, aussi range dans batch_isa.
+*/
+BatchIsa batch_detect(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        batch_isa = BATCH_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        batch_isa = BATCH_AVX2;
+    } else {
+        batch_isa = BATCH_SCALAR;
+    }
+    return batch_isa;
+}
+
+/**
+*@brief Alloue un lot pouvant contenir cap matchs.
+*@param b Le lot.
+*@param cap Le nombre maximal de matchs, arrondi au multiple de 16 superieur.
+*@return vide.
+*/
+void batch_init(Batch *b, int cap) {
+    b->cap = (cap + 15) & ~15;
+    b->count = 0;
+    b->team1 = (int*) aligned_alloc(64, b->cap * sizeof(int));
+    b->team2 = (int*) aligned_alloc(64, b->cap * sizeof(int));
+    b->score1 = (int*) aligned_alloc(64, b->cap * sizeof(int));
+    b->score2 = (int*) aligned_alloc(64, b->cap * sizeof(int));
+    b->tour = (int*) aligned_alloc(64, b->cap * sizeof(int));
+    b->s0 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->s1 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->s2 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->s3 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->goal1 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->goal2 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->miss1 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+    b->hit2 = (uint32_t*) aligned_alloc(64, b->cap * sizeof(uint32_t));
+}
+
+/**
+*@brief Vide le lot sans liberer ses tableaux.
+*@param b Le lot.
+*@return vide.
+*/
+void batch_clear(Batch *b) {
+    b->count = 0;
+}
+
+/**
+*@brief Ajoute un match au lot, avec un flux derive de (graine, tournoi, match) comme pour les autres moteurs.
+* Le flux 32 bits du match est forme des deux premiers tirages de rng_seed(seed, tournoi, match) ; ils ne dependent que des trois premiers mots de l'etat, calcules directement a partir du prefixe du tournoi.
+*@param b Le lot, qui ne doit pas etre plein.
+*@param team1 Numero de l'equipe 1.
+*@param team2 Numero de l'equipe 2.
+*@param tour Tour du match.
+*@param prefix Le prefixe du tournoi, rng_prefix(graine, tournoi).
+*@param match L'indice du match dans le tournoi.
+*@return L'indice du match dans le lot.
+*/
+int batch_add(Batch *b, int team1, int team2, int tour, uint64_t prefix, uint64_t match) {
+    int k = b->count++;
+    uint64_t z = prefix ^ match;
+    uint64_t w0 = rng_mix(z + RNG_GAMMA);
+    uint64_t w1 = rng_mix(z + 2 * RNG_GAMMA);
+    uint64_t w2 = rng_mix(z + 3 * RNG_GAMMA);
+    uint64_t x = rng_rotl(w1 * 5, 7) * 9;           // premier rng_next
+    uint64_t y = rng_rotl((w1 ^ w2 ^ w0) * 5, 7) * 9; // second rng_next : s[1] ^= s[2] ^ s[0]
+
+    b->team1[k] = team1;
+    b->team2[k] = team2;
+    b->score1[k] = 0;
+    b->score2[k] = 0;
+    b->tour[k] = tour;
+    b->s0[k] = (uint32_t) x;
+    b->s1[k] = (uint32_t) (x >> 32);
+    b->s2[k] = (uint32_t) y;
+    //xoshiro128** reste bloque sur l'etat entierement nul : forcer s3 impair l'exclut quelles que soient x et y,
+    //au prix d'un seul bit d'etat (les 127 autres restent ceux du flux splitmix du match)
+    b->s3[k] = (uint32_t) (y >> 32) | 1;
+    b->goal1[k] = GOAL1;
+    b->goal2[k] = GOAL2;
+    b->miss1[k] = MISS1;
+    b->hit2[k] = HIT2;
+    return k;
+}
+
+/**
+*@brief Remplace les chances d'origine du match k (equipes classees).
+*@param b Le lot.
+*@param k L'indice du match dans le lot.
+*@param goal1 Probabilite de but de l'equipe 1 pendant une minute.
+*@param goal2 Probabilite de but de l'equipe 2 pendant une minute.
+*@param pen1 Probabilite de reussite d'un tir au but de l'equipe 1.
+*@param pen2 Probabilite de reussite d'un tir au but de l'equipe 2.
+*@return vide.
+*/
+void batch_rate(Batch *b, int k, double goal1, double goal2, double pen1, double pen2) {
+    const double scale = 4294967296.0; // 2^32
+    b->goal1[k] = (uint32_t) (goal1 * scale);
+    b->goal2[k] = (uint32_t) ((goal1 + goal2) * scale);
+    b->miss1[k] = (uint32_t) ((1.0 - pen1) * scale);
+    b->hit2[k] = (uint32_t) (pen2 * scale);
+}
+
+/**
+ *@brief Rotation a gauche de k bits sur 32 bits
+*/
+static inline uint32_t rotl32(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/**
+*@brief Tire 32 bits du flux xoshiro128** du match k.
+*@param b Le lot.
+*@param k L'indice du match.
+*@return 32 bits uniformes.
+*/
+static inline uint32_t lane_next(Batch *b, int k) {
+    uint32_t result = rotl32(b->s1[k] * 5, 7) * 9;
+    uint32_t t = b->s1[k] << 9;
+
+    b->s2[k] ^= b->s0[k];
+    b->s3[k] ^= b->s1[k];
+    b->s1[k] ^= b->s2[k];
+    b->s0[k] ^= b->s3[k];
+    b->s2[k] ^= t;
+    b->s3[k] = rotl32(b->s3[k], 11);
+    return result;
+}
+
+/**
+*@brief Temps reglementaire, chemin scalaire : meme suite de tirages par match que les chemins vectoriels.
+*@param b Le lot.
+*@param from Premier match a simuler.
+*@param duration Duree du match en minutes.
+*@return vide.
+*/
+static void regulation_scalar(Batch *b, int from, int duration) {
+    for (int k = from; k < b->count; k++) {
+        for (int minute = 0; minute < duration; minute++) {
+            uint32_t u = lane_next(b, k);
+            b->score1[k] += u < b->goal1[k];
+            b->score2[k] += u >= b->goal1[k] && u < b->goal2[k];
+        }
+    }
+}
+
+/**
+*@brief Tirs au but du match k, chemin scalaire : 5 tirs par equipe, puis un tir chacun tant que l'egalite persiste, comme penalty_shootout.
+*@param b Le lot.
+*@param k L'indice du match, a egalite a la fin du temps reglementaire.
+*@return vide.
+*/
+static void shootout_lane(Batch *b, int k) {
+    int nTab = 5;
+    while (b->score1[k] == b->score2[k]) {
+        while (nTab > 0) {
+            b->score1[k] += lane_next(b, k) >= b->miss1[k];
+            b->score2[k] += lane_next(b, k) < b->hit2[k];
+            nTab--;
+        }
+        nTab = 1;
+    }
+}
+
+/**
+ *@brief Etat xoshiro128** de 8 matchs, dans des registres AVX2
+*/
+typedef struct Lanes8{
+    __m256i s0, s1, s2, s3;
+}Lanes8;
+
+/**
+*@brief Tire 32 bits pour chacun des 8 matchs, comme lane_next, le bit de poids fort inverse pour les comparaisons signees.
+*@param l L'etat des 8 matchs.
+*@return Les 8 tirages, signe inverse.
+*/
+__attribute__((target("avx2")))
+static inline __m256i lanes8_next(Lanes8 *l) {
+    __m256i m = _mm256_mullo_epi32(l->s1, _mm256_set1_epi32(5));
+    m = _mm256_or_si256(_mm256_slli_epi32(m, 7), _mm256_srli_epi32(m, 25));
+    __m256i u = _mm256_xor_si256(_mm256_mullo_epi32(m, _mm256_set1_epi32(9)), _mm256_set1_epi32((int) 0x80000000u));
+    __m256i t = _mm256_slli_epi32(l->s1, 9);
+    l->s2 = _mm256_xor_si256(l->s2, l->s0);
+    l->s3 = _mm256_xor_si256(l->s3, l->s1);
+    l->s1 = _mm256_xor_si256(l->s1, l->s2);
+    l->s0 = _mm256_xor_si256(l->s0, l->s3);
+    l->s2 = _mm256_xor_si256(l->s2, t);
+    l->s3 = _mm256_or_si256(_mm256_slli_epi32(l->s3, 11), _mm256_srli_epi32(l->s3, 21));
+    return u;
+}
+
+/**
+*@brief Tirs au but, chemin AVX2 : les 8 matchs d'un registre tirent ensemble, seuls les matchs encore a egalite (le masque) comptent leurs tirs. Chaque match a egalite tire la meme suite que shootout_lane ; les autres avancent leur flux pour rien, il ne sert plus.
+*@param b Le lot, apres le temps reglementaire.
+*@return Le nombre de matchs traites (multiple de 8), le reste est laisse au chemin scalaire.
+*/
+__attribute__((target("avx2")))
+static int shootout_avx2(Batch *b) {
+    const __m256i sign = _mm256_set1_epi32((int) 0x80000000u);
+    int k;
+
+    for (k = 0; k + 8 <= b->count; k += 8) {
+        __m256i sc1 = _mm256_load_si256((__m256i*) &b->score1[k]);
+        __m256i sc2 = _mm256_load_si256((__m256i*) &b->score2[k]);
+        __m256i tied = _mm256_cmpeq_epi32(sc1, sc2);
+        if (_mm256_testz_si256(tied, tied)) {
+            continue;
+        }
+        Lanes8 l = {_mm256_load_si256((__m256i*) &b->s0[k]), _mm256_load_si256((__m256i*) &b->s1[k]),
+                    _mm256_load_si256((__m256i*) &b->s2[k]), _mm256_load_si256((__m256i*) &b->s3[k])};
+        __m256i miss1 = _mm256_xor_si256(_mm256_load_si256((__m256i*) &b->miss1[k]), sign);
+        __m256i hit2 = _mm256_xor_si256(_mm256_load_si256((__m256i*) &b->hit2[k]), sign);
+        int nTab = 5;
+        while (!_mm256_testz_si256(tied, tied)) {
+            while (nTab > 0) {
+                //Masques a -1 : on soustrait pour incrementer
+                __m256i u = lanes8_next(&l);
+                sc1 = _mm256_sub_epi32(sc1, _mm256_andnot_si256(_mm256_cmpgt_epi32(miss1, u), tied));
+                u = lanes8_next(&l);
+                sc2 = _mm256_sub_epi32(sc2, _mm256_and_si256(_mm256_cmpgt_epi32(hit2, u), tied));
+                nTab--;
+            }
+            nTab = 1;
+            tied = _mm256_and_si256(tied, _mm256_cmpeq_epi32(sc1, sc2));
+        }
+        _mm256_store_si256((__m256i*) &b->score1[k], sc1);
+        _mm256_store_si256((__m256i*) &b->score2[k], sc2);
+    }
+    return k;
+}
+
+/**
+ *@brief Etat xoshiro128** de 16 matchs, dans des registres AVX-512
+*/
+typedef struct Lanes16{
+    __m512i s0, s1, s2, s3;
+}Lanes16;
+
+/**
+*@brief Tire 32 bits pour chacun des 16 matchs, comme lane_next.
+*@param l L'etat des 16 matchs.
+*@return Les 16 tirages.
+*/
+__attribute__((target("avx512f")))
+static inline __m512i lanes16_next(Lanes16 *l) {
+    __m512i u = _mm512_mullo_epi32(_mm512_rol_epi32(_mm512_mullo_epi32(l->s1, _mm512_set1_epi32(5)), 7), _mm512_set1_epi32(9));
+    __m512i t = _mm512_slli_epi32(l->s1, 9);
+    l->s2 = _mm512_xor_si512(l->s2, l->s0);
+    l->s3 = _mm512_xor_si512(l->s3, l->s1);
+    l->s1 = _mm512_xor_si512(l->s1, l->s2);
+    l->s0 = _mm512_xor_si512(l->s0, l->s3);
+    l->s2 = _mm512_xor_si512(l->s2, t);
+    l->s3 = _mm512_rol_epi32(l->s3, 11);
+    return u;
+}
+
+/**
+*@brief Tirs au but, chemin AVX-512 : comme shootout_avx2, sur 16 matchs avec un masque de registre.
+*@param b Le lot, apres le temps reglementaire.
+*@return Le nombre de matchs traites (multiple de 16), le reste est laisse au chemin scalaire.
+*/
+__attribute__((target("avx512f")))
+static int shootout_avx512(Batch *b) {
+    const __m512i one = _mm512_set1_epi32(1);
+    int k;
+
+    for (k = 0; k + 16 <= b->count; k += 16) {
+        __m512i sc1 = _mm512_load_si512(&b->score1[k]);
+        __m512i sc2 = _mm512_load_si512(&b->score2[k]);
+        __mmask16 tied = _mm512_cmpeq_epi32_mask(sc1, sc2);
+        if (tied == 0) {
+            continue;
+        }
+        Lanes16 l = {_mm512_load_si512(&b->s0[k]), _mm512_load_si512(&b->s1[k]),
+                     _mm512_load_si512(&b->s2[k]), _mm512_load_si512(&b->s3[k])};
+        __m512i miss1 = _mm512_load_si512(&b->miss1[k]);
+        __m512i hit2 = _mm512_load_si512(&b->hit2[k]);
+        int nTab = 5;
+        while (tied != 0) {
+            while (nTab > 0) {
+                sc1 = _mm512_mask_add_epi32(sc1, tied & _mm512_cmpge_epu32_mask(lanes16_next(&l), miss1), sc1, one);
+                sc2 = _mm512_mask_add_epi32(sc2, tied & _mm512_cmplt_epu32_mask(lanes16_next(&l), hit2), sc2, one);
+                nTab--;
+            }
+            nTab = 1;
+            tied &= _mm512_cmpeq_epi32_mask(sc1, sc2);
+        }
+        _mm512_store_si512(&b->score1[k], sc1);
+        _mm512_store_si512(&b->score2[k], sc2);
+    }
+    return k;
+}
+
+/**
+*@brief Temps reglementaire, chemin AVX2 : 8 matchs par registre. Les comparaisons non signees sont faites en signe en inversant le bit de poids fort.
+*@param b Le lot.
+*@param duration Duree du match en minutes.
+*@return Le nombre de matchs traites (multiple de 8), le reste est laisse au chemin scalaire.
+*/
+__attribute__((target("avx2")))
+static int regulation_avx2(Batch *b, int duration) {
+    const __m256i sign = _mm256_set1_epi32((int) 0x80000000u);
+    const __m256i five = _mm256_set1_epi32(5);
+    const __m256i nine = _mm256_set1_epi32(9);
+    int k;
+
+    for (k = 0; k + 8 <= b->count; k += 8) {
+        __m256i s0 = _mm256_load_si256((__m256i*) &b->s0[k]);
+        __m256i s1 = _mm256_load_si256((__m256i*) &b->s1[k]);
+        __m256i s2 = _mm256_load_si256((__m256i*) &b->s2[k]);
+        __m256i s3 = _mm256_load_si256((__m256i*) &b->s3[k]);
+        __m256i sc1 = _mm256_load_si256((__m256i*) &b->score1[k]);
+        __m256i sc2 = _mm256_load_si256((__m256i*) &b->score2[k]);
+        __m256i goal1 = _mm256_xor_si256(_mm256_load_si256((__m256i*) &b->goal1[k]), sign);
+        __m256i goal2 = _mm256_xor_si256(_mm256_load_si256((__m256i*) &b->goal2[k]), sign);
+
+        for (int minute = 0; minute < duration; minute++) {
+            __m256i m = _mm256_mullo_epi32(s1, five);
+            m = _mm256_or_si256(_mm256_slli_epi32(m, 7), _mm256_srli_epi32(m, 25));
+            __m256i u = _mm256_xor_si256(_mm256_mullo_epi32(m, nine), sign);
+            __m256i t = _mm256_slli_epi32(s1, 9);
+            s2 = _mm256_xor_si256(s2, s0);
+            s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2);
+            s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+
+            //Masques a -1 : on soustrait pour incrementer
+            __m256i lt1 = _mm256_cmpgt_epi32(goal1, u);
+            __m256i lt2 = _mm256_cmpgt_epi32(goal2, u);
+            sc1 = _mm256_sub_epi32(sc1, lt1);
+            sc2 = _mm256_add_epi32(_mm256_sub_epi32(sc2, lt2), lt1);
+        }
+        _mm256_store_si256((__m256i*) &b->s0[k], s0);
+        _mm256_store_si256((__m256i*) &b->s1[k], s1);
+        _mm256_store_si256((__m256i*) &b->s2[k], s2);
+        _mm256_store_si256((__m256i*) &b->s3[k], s3);
+        _mm256_store_si256((__m256i*) &b->score1[k], sc1);
+        _mm256_store_si256((__m256i*) &b->score2[k], sc2);
+    }
+    return k;
+}
+
+/**
+*@brief Temps reglementaire, chemin AVX-512 : 16 matchs par registre, comparaisons non signees et rotations natives.
+*@param b Le lot.
+*@param duration Duree du match en minutes.
+*@return Le nombre de matchs traites (multiple de 16), le reste est laisse au chemin scalaire.
+*/
+__attribute__((target("avx512f")))
+static int regulation_avx512(Batch *b, int duration) {
+    const __m512i five = _mm512_set1_epi32(5);
+    const __m512i nine = _mm512_set1_epi32(9);
+    const __m512i one = _mm512_set1_epi32(1);
+    int k;
+
+    for (k = 0; k + 16 <= b->count; k += 16) {
+        __m512i s0 = _mm512_load_si512(&b->s0[k]);
+        __m512i s1 = _mm512_load_si512(&b->s1[k]);
+        __m512i s2 = _mm512_load_si512(&b->s2[k]);
+        __m512i s3 = _mm512_load_si512(&b->s3[k]);
+        __m512i sc1 = _mm512_load_si512(&b->score1[k]);
+        __m512i sc2 = _mm512_load_si512(&b->score2[k]);
+        __m512i goal1 = _mm512_load_si512(&b->goal1[k]);
+        __m512i goal2 = _mm512_load_si512(&b->goal2[k]);
+
+        for (int minute = 0; minute < duration; minute++) {
+            __m512i u = _mm512_mullo_epi32(_mm512_rol_epi32(_mm512_mullo_epi32(s1, five), 7), nine);
+            __m512i t = _mm512_slli_epi32(s1, 9);
+            s2 = _mm512_xor_si512(s2, s0);
+            s3 = _mm512_xor_si512(s3, s1);
+            s1 = _mm512_xor_si512(s1, s2);
+            s0 = _mm512_xor_si512(s0, s3);
+            s2 = _mm512_xor_si512(s2, t);
+            s3 = _mm512_rol_epi32(s3, 11);
+
+            __mmask16 lt1 = _mm512_cmplt_epu32_mask(u, goal1);
+            __mmask16 lt2 = _mm512_cmplt_epu32_mask(u, goal2);
+            sc1 = _mm512_mask_add_epi32(sc1, lt1, sc1, one);
+            sc2 = _mm512_mask_add_epi32(sc2, lt2 & ~lt1, sc2, one);
+        }
+        _mm512_store_si512(&b->s0[k], s0);
+        _mm512_store_si512(&b->s1[k], s1);
+        _mm512_store_si512(&b->s2[k], s2);
+        _mm512_store_si512(&b->s3[k], s3);
+        _mm512_store_si512(&b->score1[k], sc1);
+        _mm512_store_si512(&b->score2[k], sc2);
+    }
+    return k;
+}
+
+/**
+*@brief Simule tous les matchs du lot : le temps reglementaire avance tous les matchs ensemble minute par minute avec le chemin vectoriel retenu, puis les matchs a egalite (le masque) jouent leurs tirs au but, eux aussi par registre, avec les memes chances que penalty_shootout.
+*@param b Le lot.
+*@param duration Duree du match en minutes.
+*@return vide.
+*/
+void batch_run(Batch *b, int duration) {
+    int done = 0;
+
+    if (batch_isa == BATCH_AVX512) {
+        done = regulation_avx512(b, duration);
+    } else if (batch_isa == BATCH_AVX2) {
+        done = regulation_avx2(b, duration);
+    }
+    regulation_scalar(b, done, duration);
+
+    //Queue masquee : seuls les matchs nuls de chaque registre comptent leurs tirs au but
+    done = 0;
+    if (batch_isa == BATCH_AVX512) {
+        done = shootout_avx512(b);
+    } else if (batch_isa == BATCH_AVX2) {
+        done = shootout_avx2(b);
+    }
+    for (int k = done; k < b->count; k++) {
+        shootout_lane(b, k);
+    }
+}
+
+/**
+*@brief Vainqueur d'un match du lot apres batch_run.
+*@param b Le lot.
+*@param k L'indice du match.
+*@return Le numero de l'equipe gagnante.
+*/
+int batch_winner(Batch *b, int k) {
+    return b->score1[k] > b->score2[k] ? b->team1[k] : b->team2[k];
+}
+
+/**
+*@brief Libere les tableaux du lot.
+*@param b Le lot.
+*@return vide.
+*/
+void batch_free(Batch *b) {
+    free(b->team1);
+    free(b->team2);
+    free(b->score1);
+    free(b->score2);
+    free(b->tour);
+    free(b->s0);
+    free(b->s1);
+    free(b->s2);
+    free(b->s3);
+    free(b->goal1);
+    free(b->goal2);
+    free(b->miss1);
+    free(b->hit2);
+}
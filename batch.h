@@ -0,0 +1,53 @@
+#ifndef OS_BATCH_H
+#define OS_BATCH_H
+
+#include <stdint.h>
+#include "rng.h"
+
+/**
+ *@brief Jeu d'instructions utilise par le moteur par lots, choisi a l'execution
+*/
+typedef enum BatchIsa{
+    BATCH_SCALAR,
+    BATCH_AVX2,
+    BATCH_AVX512
+}BatchIsa;
+
+/**
+ *@brief Lot de matchs stocke en structure de tableaux (SoA) : le match k du lot est decrit par
+ * team1[k], team2[k], score1[k], score2[k], tour[k], et son flux aleatoire xoshiro128** par
+ * s0[k]..s3[k]. Tous les matchs du lot avancent ensemble d'une minute a la fois.
+ * Les chances de chaque match sont des seuils sur un tirage u de 32 bits : but de l'equipe 1 si
+ * u < goal1[k], de l'equipe 2 si goal1[k] <= u < goal2[k] ; aux tirs au but, l'equipe 1 marque
+ * si u >= miss1[k] et l'equipe 2 si u < hit2[k].
+*/
+typedef struct Batch{
+    int count;          // nombre de matchs dans le lot
+    int cap;            // capacite des tableaux (multiple de 16)
+    int *team1;
+    int *team2;
+    int *score1;
+    int *score2;
+    int *tour;
+    uint32_t *s0;       // etat du generateur de chaque match
+    uint32_t *s1;
+    uint32_t *s2;
+    uint32_t *s3;
+    uint32_t *goal1;    // seuils de chaque match
+    uint32_t *goal2;
+    uint32_t *miss1;
+    uint32_t *hit2;
+}Batch;
+
+extern BatchIsa batch_isa;
+
+BatchIsa batch_detect(void);
+void batch_init(Batch *b, int cap);
+void batch_clear(Batch *b);
+int batch_add(Batch *b, int team1, int team2, int tour, uint64_t prefix, uint64_t match);
+void batch_rate(Batch *b, int k, double goal1, double goal2, double pen1, double pen2);
+void batch_run(Batch *b, int duration);
+int batch_winner(Batch *b, int k);
+void batch_free(Batch *b);
+
+#endif
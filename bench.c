@@ -0,0 +1,390 @@
+#include "fonctions.h"
+#include "bracket.h"
+#include "montecarlo.h"
+#include "batch.h"
+#include "table.h"
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+/**
+ * @file bench.c
+ * @brief Banc d'essai des moteurs de simulation et de l'ordonnancement des matchs
+ * Execute sans interaction des charges fixes et reproductibles (graine fixe) : un tableau de 64 equipes,
+ * un grand tableau, un million de tournois Monte Carlo et un balayage du nombre de workers de 1 a N.
+ * Les mesures (matchs/s, tournois/s, latence p50/p99 par match, pic de memoire) sont ecrites en JSON
+ * sur la sortie standard. Chaque charge s'execute dans un processus fils, dont le pic de memoire est lu par wait4 :
+ * il ne comprend ni celui des charges precedentes ni celui du banc d'essai.
+*/
+
+/**
+ *@brief Variables globales du simulateur, definies ici comme dans main.c
+*/
+int match_duration = DURATION;
+int num_teams;
+TeamTable teams;
+int * teams_remaining;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+Bracket bracket;
+Options options;
+
+/**
+ *@brief Mesures d'une charge
+*/
+typedef struct Result{
+    char name[48];
+    int threads;
+    int teams;
+    long tournaments;
+    long matches;
+    double seconds;
+    double p50_us;      // latence mediane d'un match, negative si non mesuree
+    double p99_us;
+    long rss_kb;        // pic de memoire du processus fils qui a execute la charge
+}Result;
+
+/**
+ *@brief Nombre cible de tournois echantillonnes pour la latence des charges Monte Carlo
+*/
+#define LATENCY_TOURNAMENTS 1000
+
+/**
+ *@brief Duree de chaque match du tableau en cours, indicee comme bracket.matchs (en nanosecondes)
+*/
+static double *latency;
+
+/**
+ *@brief Nombre de resultats ecrits, pour placer les virgules du JSON
+*/
+static int printed = 0;
+
+/**
+*@brief Horloge monotone.
+*@return Le temps courant en secondes.
+*/
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+*@brief Pic de memoire residente du banc d'essai et de ses processus fils.
+*@return Le pic en kilo-octets.
+*/
+static long peak_rss(void) {
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    return self.ru_maxrss > children.ru_maxrss ? self.ru_maxrss : children.ru_maxrss;
+}
+
+/**
+*@brief Tache du pool qui chronometre simulate_match.
+*@param arg Le match a simuler.
+*@return NULL
+*/
+static void *timed_match(void *arg) {
+    Match match = (Match) arg;
+    double start = now();
+    simulate_match(match);
+    latency[match - bracket.matchs] = (now() - start) * 1e9;
+    return NULL;
+}
+
+/**
+*@brief Compare deux durees, pour qsort.
+*@param a Pointeur sur la premiere duree.
+*@param b Pointeur sur la seconde duree.
+*@return Un entier negatif, nul ou positif.
+*/
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da > db) - (da < db);
+}
+
+/**
+*@brief Calcule les latences p50 et p99 d'une charge, en microsecondes.
+*@param r Les mesures, completees.
+*@param all Les durees des matchs en nanosecondes, triees sur place.
+*@param count Le nombre de durees.
+*@return vide.
+*/
+static void percentiles(Result *r, double *all, long count) {
+    if (count == 0) {
+        return;
+    }
+    qsort(all, count, sizeof(double), compare_doubles);
+    r->p50_us = all[count / 2] / 1e3;
+    r->p99_us = all[(long) (count * 0.99)] / 1e3;
+}
+
+/**
+*@brief Charge n equipes generees ("Equipe 1" a "Equipe n") par read_team_names, au travers d'un fichier temporaire.
+*@param n Le nombre d'equipes.
+*@return vide.
+*/
+static void load_teams(int n) {
+    char path[] = "/tmp/bench_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (fp == NULL) {
+        printf("Erreur lors de la creation du fichier d'equipes.\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(fp, "%d\n", match_duration);
+    for (int i = 1; i <= n; i++) {
+        fprintf(fp, "Equipe %d\n", i);
+    }
+    fclose(fp);
+    read_team_names(path, &num_teams, &teams);
+    unlink(path); // le fichier reste projete jusqu'a free_memory
+    if (options.engine == ENGINE_TABLE && table_build(&outcomes) < 0) {
+        printf("Tables de resultats trop grandes.\n");
+        exit(EXIT_FAILURE);
+    }
+    teams_remaining = (int *)malloc(num_teams*sizeof(int));
+    for (int i = 0; i < num_teams; i++) {
+        teams_remaining[i] = 1;
+    }
+}
+
+/**
+*@brief Ecrit les mesures d'une charge en JSON.
+*@param r Les mesures.
+*@return vide.
+*/
+static void print_result(Result *r) {
+    printf("%s    {\"name\": \"%s\", \"threads\": %d, \"teams\": %d, \"tournaments\": %ld, \"matches\": %ld, \"seconds\": %.6f, ",
+           printed++ > 0 ? ",\n" : "", r->name, r->threads, r->teams, r->tournaments, r->matches, r->seconds);
+    printf("\"matches_per_sec\": %.1f, \"tournaments_per_sec\": %.3f, ", r->matches / r->seconds, r->tournaments / r->seconds);
+    if (r->p50_us >= 0) {
+        printf("\"p50_us\": %.3f, \"p99_us\": %.3f, ", r->p50_us, r->p99_us);
+    } else {
+        printf("\"p50_us\": null, \"p99_us\": null, ");
+    }
+    printf("\"peak_rss_kb\": %ld}", r->rss_kb);
+    fflush(stdout);
+}
+
+/**
+*@brief Simule r->tournaments tournois concurrents complets de r->teams equipes (bracket_run sur un pool neuf de r->threads workers, comme le mode 1 de main), chacun avec sa propre graine, et chronometre chaque match.
+*@param r Les mesures, dont le nom, les equipes, les workers et les tournois sont remplis par l'appelant.
+*@return vide.
+*/
+static void bench_bracket(Result *r) {
+    int n = r->teams;
+    load_teams(n);
+    int size = bracket_size(n);
+    double *all = (double*) malloc((size_t) r->tournaments * (size - 1) * sizeof(double));
+    latency = (double*) malloc((size - 1) * sizeof(double));
+
+    for (int rep = 0; rep < r->tournaments; rep++) {
+        for (int i = 0; i < num_teams; i++) {
+            teams_remaining[i] = 1;
+        }
+        bracket_init(&bracket, n, options.seed + rep);
+        bracket.play = timed_match;
+        double start = now();
+        Pool pool;
+        pool_init(&pool, r->threads);
+        bracket_run(&bracket, &pool);
+        pool_destroy(&pool);
+        r->seconds += now() - start;
+        for (int i = 0; i < bracket.num_matchs; i++) {
+            if (bracket.matchs[i].team2 >= 0) {
+                all[r->matches++] = latency[i];
+            }
+        }
+        bracket_free(&bracket);
+    }
+    percentiles(r, all, r->matches);
+    free(latency);
+    free(all);
+    if (options.engine == ENGINE_TABLE) {
+        table_free(&outcomes);
+    }
+    free_memory();
+}
+
+/**
+*@brief Simule r->tournaments tournois Monte Carlo de r->teams equipes sur un pool neuf de r->threads workers. La duree des matchs d'environ LATENCY_TOURNAMENTS tournois repartis sur toute la charge est echantillonnee (MonteCarlo.latency) ; avec le moteur par lots, c'est la duree du lot divisee par son nombre de matchs.
+*@param r Les mesures, dont le nom, les equipes, les workers et les tournois sont remplis par l'appelant.
+*@return vide.
+*/
+static void bench_montecarlo(Result *r) {
+    int n = r->teams;
+    load_teams(n);
+    MonteCarlo mc;
+    montecarlo_init(&mc, n, r->tournaments, options.seed);
+    mc.latency_every = r->tournaments / LATENCY_TOURNAMENTS > 0 ? r->tournaments / LATENCY_TOURNAMENTS : 1;
+    size_t slots = (size_t) ((r->tournaments - 1) / mc.latency_every + 1) * (mc.size - 1);
+    mc.latency = (double*) malloc(slots * sizeof(double));
+    for (size_t i = 0; i < slots; i++) {
+        mc.latency[i] = -1; // les exemptions ne sont pas chronometrees
+    }
+    double start = now();
+    Pool pool;
+    pool_init(&pool, r->threads);
+    montecarlo_run(&mc, &pool);
+    pool_destroy(&pool);
+    r->seconds = now() - start;
+    r->matches = r->tournaments * (n - 1); // chaque match elimine une equipe
+    long count = 0;
+    for (size_t i = 0; i < slots; i++) {
+        if (mc.latency[i] >= 0) {
+            mc.latency[count++] = mc.latency[i];
+        }
+    }
+    percentiles(r, mc.latency, count);
+    free(mc.latency);
+    montecarlo_free(&mc);
+    if (options.engine == ENGINE_TABLE) {
+        table_free(&outcomes);
+    }
+    free_memory();
+}
+
+/**
+*@brief Execute une charge dans un processus fils, qui renvoie ses mesures par un tube, puis l'ecrit en JSON avec le pic de memoire du fils (wait4).
+*@param name Le nom de la charge.
+*@param run La charge, bench_bracket ou bench_montecarlo.
+*@param n Le nombre d'equipes.
+*@param threads Le nombre de workers.
+*@param tournaments Le nombre de tournois.
+*@return vide.
+*/
+static void bench_workload(const char *name, void (*run)(Result *), int n, int threads, long tournaments) {
+    Result r = {"", threads, n, tournaments, 0, 0, -1, -1, 0};
+    int fds[2];
+    snprintf(r.name, sizeof(r.name), "%s", name);
+
+    fflush(stdout);
+    if (pipe(fds) < 0) {
+        printf("Erreur lors de la creation du tube.\n");
+        exit(EXIT_FAILURE);
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Erreur lors de la creation du processus de la charge %s.\n", name);
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        run(&r);
+        _exit(write(fds[1], &r, sizeof(Result)) == sizeof(Result) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(fds[1]);
+    size_t got = 0;
+    ssize_t len;
+    while (got < sizeof(Result) && (len = read(fds[0], (char*) &r + got, sizeof(Result) - got)) > 0) {
+        got += len;
+    }
+    close(fds[0]);
+
+    struct rusage ru;
+    int status;
+    if (wait4(pid, &status, 0, &ru) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || got != sizeof(Result)) {
+        printf("Echec de la charge %s.\n", name);
+        exit(EXIT_FAILURE);
+    }
+    r.rss_kb = ru.ru_maxrss;
+    print_result(&r);
+}
+
+/**
+ *@brief Affiche l'utilisation du banc d'essai et quitte en erreur
+ *@param prog Nom du programme (argv[0])
+*/
+static void usage(char *prog)
+{
+    printf("Usage : %s [--threads N] [--seed S] [--engine minute|skip|batch|table] [--runs N] [--teams N]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ *@brief Fonction principale du banc d'essai
+ *@param argc Nombre d'arguments passés au programme
+ *@param argv Options : nombre maximal de workers, graine, moteur, nombre de tournois Monte Carlo, taille du grand tableau
+ *@return 0
+*/
+int main(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 's'},
+        {"engine", required_argument, NULL, 'e'},
+        {"runs", required_argument, NULL, 'r'},
+        {"teams", required_argument, NULL, 'n'},
+        {NULL, 0, NULL, 0}
+    };
+    static const char *engines[] = {"minute", "skip", "batch", "table"};
+    long runs = 1000000;
+    int large = 4096;
+    int opt;
+
+    options.threads = pool_default_threads();
+    options.seed = 42;
+    options.quiet = 2; // aucun evenement affiche : seule la simulation est mesuree
+    while ((opt = getopt_long(argc, argv, "t:s:e:r:n:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                options.threads = atoi(optarg);
+                if (options.threads <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 's':
+                options.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'e':
+                if (strcmp(optarg, "minute") == 0) {
+                    options.engine = ENGINE_MINUTE;
+                } else if (strcmp(optarg, "skip") == 0) {
+                    options.engine = ENGINE_SKIP;
+                } else if (strcmp(optarg, "batch") == 0) {
+                    options.engine = ENGINE_BATCH;
+                } else if (strcmp(optarg, "table") == 0) {
+                    options.engine = ENGINE_TABLE;
+                } else {
+                    usage(argv[0]);
+                }
+                break;
+            case 'r':
+                runs = atol(optarg);
+                if (runs <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'n':
+                large = atoi(optarg);
+                if (large < 2) {
+                    usage(argv[0]);
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    batch_detect();
+
+    int max = options.threads;
+    printf("{\n  \"seed\": %llu,\n  \"engine\": \"%s\",\n  \"threads\": %d,\n  \"workloads\": [\n",
+           (unsigned long long) options.seed, engines[options.engine], max);
+    char name[48];
+    bench_workload("bracket_64", bench_bracket, 64, max, 10);
+    snprintf(name, sizeof(name), "bracket_%d", large);
+    bench_workload(name, bench_bracket, large, max, 1);
+    bench_workload("montecarlo_64", bench_montecarlo, 64, max, runs);
+
+    //Balayage du nombre de workers : 1, 2, 4, ... puis le maximum
+    for (int t = 1; ; t = t * 2 < max ? t * 2 : max) {
+        bench_workload("sweep_bracket_1024", bench_bracket, 1024, t, 1);
+        bench_workload("sweep_montecarlo_64", bench_montecarlo, 64, t, runs / 10 > 0 ? runs / 10 : 1);
+        if (t == max) {
+            break;
+        }
+    }
+    printf("\n  ],\n  \"peak_rss_kb\": %ld\n}\n", peak_rss());
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "bracket.h"
+
+static void bracket_advance(Bracket *b, Match match, int winner);
+
+/**
+*@brief Taille du tableau pour num_teams equipes : la plus petite puissance de 2 superieure ou egale.
+*@param num_teams Le nombre d'equipes.
+*@return Le nombre de places du premier tour.
+*/
+int bracket_size(int num_teams) {
+    int size = 1;
+    while (size < num_teams) {
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+*@brief Place les equipes dans les size places du premier tour, en completant avec size - num_teams exemptions (-1). Les exemptions sont reparties regulierement sur les matchs du premier tour, toujours en deuxieme position, afin qu'aucun match n'oppose deux exemptions.
+*@param num_teams Le nombre d'equipes.
+*@param size Le nombre de places, bracket_size(num_teams).
+*@param order L'ordre des equipes a placer, ou NULL pour 0, 1, ..., num_teams - 1.
+*@param slots Le tableau de size places a remplir.
+*@return vide.
+*/
+void bracket_slots(int num_teams, int size, const int *order, int *slots) {
+    int half = size / 2;
+    long byes = size - num_teams;
+    int next = 0;
+
+    for (int p = 0; p < half; p++) {
+        slots[2 * p] = order ? order[next] : next;
+        next++;
+        //Le match p est une exemption si la repartition reguliere de byes exemptions sur half matchs y en met une
+        if ((p + 1) * byes / half > p * byes / half) {
+            slots[2 * p + 1] = -1;
+        } else {
+            slots[2 * p + 1] = order ? order[next] : next;
+            next++;
+        }
+    }
+}
+
+/**
+*@brief Tire le tableau du tournoi t sans toucher a l'ordre global des equipes : permutation aleatoire des equipes, avec le meme flux que read_team_names, puis placement avec exemptions comme dans bracket_init.
+*@param num_teams Le nombre d'equipes.
+*@param size Le nombre de places du premier tour, bracket_size(num_teams).
+*@param seed La graine globale.
+*@param t Le numero du tournoi.
+*@param perm Tableau de travail de num_teams entiers.
+*@param slots Le tableau a remplir avec les size places du premier tour (-1 pour une exemption).
+*@return vide.
+*/
+void bracket_draw(int num_teams, int size, uint64_t seed, long t, int *perm, int *slots) {
+    Rng rng;
+    rng_seed(&rng, seed, t, RNG_STREAM_SHUFFLE);
+    for (int i = 0; i < num_teams; i++) {
+        perm[i] = i;
+    }
+    for (int i = num_teams - 1; i > 0; i--) {
+        int j = rng_below(&rng, i + 1);
+        int tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
+    bracket_slots(num_teams, size, perm, slots);
+}
+
+/**
+*@brief Initialise le tableau du tournoi : alloue les matchs une seule fois, place les equipes du premier tour (deja melangees par read_team_names) avec des exemptions si le nombre d'equipes n'est pas une puissance de 2, et met tous les matchs du premier tour dans la file des matchs prets.
+* Une exemption est une case du premier tour avec team2 == -1 : l'equipe passe directement au tour 2 sans jouer.
+*@param b Le tableau du tournoi a initialiser.
+*@param num_teams Le nombre d'equipes, au moins 2.
+*@param seed La graine dont sont derives les flux aleatoires des matchs (un flux par indice de match).
+*@return vide.
+*/
+void bracket_init(Bracket *b, int num_teams, uint64_t seed) {
+    int size = bracket_size(num_teams);
+    int *slots = (int*) malloc(size * sizeof(int));
+
+    b->num_matchs = size - 1;
+    b->matchs = (struct Match*) malloc(b->num_matchs * sizeof(struct Match));
+    b->ready = (int*) malloc(b->num_matchs * sizeof(int));
+    b->head = 0;
+    b->tail = 0;
+    b->done = 0;
+    b->pool = NULL;
+    b->play = simulate_match;
+    pthread_cond_init(&b->cond, NULL);
+
+    for (int i = 0; i < b->num_matchs; i++) {
+        b->matchs[i].team1 = -1; // equipe pas encore connue
+        b->matchs[i].team2 = -1;
+        b->matchs[i].score1 = 0;
+        b->matchs[i].score2 = 0;
+        b->matchs[i].tour = 1;
+        rng_seed(&b->matchs[i].rng, seed, 0, i);
+    }
+
+    //Premier tour : les matchs entre deux equipes sont prets
+    bracket_slots(num_teams, size, NULL, slots);
+    for (int i = 0; i < size / 2; i++) {
+        b->matchs[i].team1 = slots[2 * i];
+        b->matchs[i].team2 = slots[2 * i + 1];
+        if (slots[2 * i + 1] >= 0) {
+            b->ready[b->tail++] = i;
+        }
+    }
+    //Les equipes exemptees passent au tour 2
+    for (int i = 0; i < size / 2; i++) {
+        if (slots[2 * i + 1] < 0) {
+            teams_remaining[slots[2 * i]] = 2;
+            b->done++;
+            bracket_advance(b, &b->matchs[i], slots[2 * i]);
+        }
+    }
+    free(slots);
+}
+
+/**
+*@brief Rend un match pret : il est soumis au pool si le tableau en a un, sinon il est ajoute a la file, videe par la boucle du mode manuel (bracket_poll).
+*@pre Le mutex global doit etre verrouille par l'appelant.
+*@param b Le tableau du tournoi.
+*@param id L'indice du match dont les deux equipes sont connues.
+*@return vide.
+*/
+static void bracket_push(Bracket *b, int id) {
+    if (b->pool != NULL) {
+        teams_remaining[b->matchs[id].team1] = 0;
+        teams_remaining[b->matchs[id].team2] = 0;
+        pool_submit(b->pool, b->play, &b->matchs[id]);
+    } else {
+        b->ready[b->tail++] = id;
+    }
+}
+
+/**
+*@brief Execute tout le tournoi sur le pool : les matchs du premier tour sont soumis, puis chaque match termine soumet lui-meme le match suivant depuis son worker. Le thread appelant dort jusqu'a la fin de la finale.
+*@param b Le tableau du tournoi, tel que prepare par bracket_init.
+*@param pool Le pool de workers qui simule les matchs.
+*@return vide.
+*/
+void bracket_run(Bracket *b, Pool *pool) {
+    STATS_LOCK(&mutex);
+    b->pool = pool;
+    while (b->head != b->tail) {
+        bracket_push(b, b->ready[b->head++]);
+    }
+    while (b->done < b->num_matchs) {
+        pthread_cond_wait(&b->cond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/**
+*@brief Retire un match de la file des matchs prets, sans attendre : la boucle d'evenements du mode manuel lance ainsi tous les matchs prets d'un coup.
+* Les deux equipes du match retourne sont marquees "en train de jouer" (0) dans teams_remaining.
+*@param b Le tableau du tournoi.
+*@return L'indice du match a lancer, ou -1 si aucun match n'est pret pour l'instant.
+*/
+int bracket_poll(Bracket *b) {
+    int id = -1;
+
+    STATS_LOCK(&mutex);
+    if (b->head != b->tail) {
+        id = b->ready[b->head++];
+        teams_remaining[b->matchs[id].team1] = 0;
+        teams_remaining[b->matchs[id].team2] = 0;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return id;
+}
+
+/**
+*@brief Place le vainqueur d'un match dans le match du tour suivant, qui est rendu pret (bracket_push) des que son adversaire est connu.
+*@pre Le mutex global doit etre verrouille par l'appelant, ou le tableau ne doit pas encore etre partage.
+*@param b Le tableau du tournoi.
+*@param match Le match termine (ou l'exemption), qui doit appartenir a b->matchs.
+*@param winner Le numero de l'equipe gagnante.
+*@return vide.
+*/
+static void bracket_advance(Bracket *b, Match match, int winner) {
+    int id = match - b->matchs;
+    int size = b->num_matchs + 1;
+
+    if (id < b->num_matchs - 1) { // Ce n'est pas la finale
+        int next = size / 2 + id / 2;
+        if (id % 2 == 0) {
+            b->matchs[next].team1 = winner;
+        } else {
+            b->matchs[next].team2 = winner;
+        }
+        b->matchs[next].tour = match->tour + 1;
+        if (b->matchs[next].team1 >= 0 && b->matchs[next].team2 >= 0) {
+            bracket_push(b, next);
+        }
+    }
+}
+
+/**
+*@brief Enregistre le vainqueur d'un match termine : il est qualifie pour le match suivant (bracket_advance). Le thread principal est reveille a la fin du tournoi.
+*@pre Le mutex global doit etre verrouille par l'appelant.
+*@param b Le tableau du tournoi.
+*@param match Le match termine, qui doit appartenir a b->matchs.
+*@param winner Le numero de l'equipe gagnante.
+*@return vide.
+*/
+void bracket_report(Bracket *b, Match match, int winner) {
+    b->done++;
+    bracket_advance(b, match, winner);
+    if (b->done == b->num_matchs) { // Fin du tournoi
+        pthread_cond_broadcast(&b->cond);
+    }
+}
+
+/**
+*@brief Libere la memoire du tableau du tournoi.
+*@param b Le tableau du tournoi.
+*@return vide.
+*/
+void bracket_free(Bracket *b) {
+    pthread_cond_destroy(&b->cond);
+    free(b->ready);
+    free(b->matchs);
+}
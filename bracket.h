@@ -0,0 +1,40 @@
+#ifndef OS_BRACKET_H
+#define OS_BRACKET_H
+
+#include "fonctions.h"
+#include "pool.h"
+
+/**
+ *@brief Tableau du tournoi (bracket) a elimination directe.
+ * Les matchs sont ranges tour par tour dans un tableau contigu : les size/2 matchs du tour 1,
+ * puis ceux du tour 2, etc., ou size = bracket_size(num_teams). La finale est le dernier match.
+ * Le vainqueur du match i rejoint le match size/2 + i/2, en tant qu'equipe 1 si i est pair et
+ * equipe 2 sinon. Les cases du tour 1 avec team2 == -1 sont des exemptions.
+ * Les matchs dont les deux equipes sont connues sont soit soumis directement au pool de workers
+ * (simulation concurrente), soit places dans une file de matchs prets protegee par le mutex global,
+ * videe par la boucle d'evenements du mode manuel.
+*/
+typedef struct Bracket{
+    struct Match *matchs; // toutes les cases du tableau (size - 1), exemptions comprises
+    int num_matchs;       // nombre total de cases
+    int *ready;           // file lineaire des indices de matchs prets, de num_matchs cases allouees une fois pour tout le tournoi (head et tail ne font que croitre)
+    int head;             // tete de la file
+    int tail;             // queue de la file
+    int done;             // nombre de cases terminees (matchs joues et exemptions)
+    Pool *pool;           // pool qui execute les matchs prets, NULL pour utiliser la file
+    void *(*play)(void*); // tache soumise au pool pour chaque match pret, simulate_match par defaut
+    pthread_cond_t cond;  // signalee a chaque match pret ou a la fin du tournoi
+}Bracket;
+
+extern Bracket bracket;
+
+int bracket_size(int num_teams);
+void bracket_slots(int num_teams, int size, const int *order, int *slots);
+void bracket_draw(int num_teams, int size, uint64_t seed, long t, int *perm, int *slots);
+void bracket_init(Bracket *b, int num_teams, uint64_t seed);
+int bracket_poll(Bracket *b);
+void bracket_run(Bracket *b, Pool *pool);
+void bracket_report(Bracket *b, Match match, int winner);
+void bracket_free(Bracket *b);
+
+#endif
@@ -0,0 +1,216 @@
+#include "checkpoint.h"
+
+/**
+*@brief Horloge monotone.
+*@return Le temps courant en secondes.
+*/
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+*@brief Empreinte FNV-1a 64 bits, a enchainer sur plusieurs tampons.
+*@param h L'empreinte courante (14695981039346656037 au depart).
+*@param data Les octets a ajouter.
+*@param len Le nombre d'octets.
+*@return La nouvelle empreinte.
+*/
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*) data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+*@brief Empreinte de la table des equipes dans l'ordre melange : une reprise avec un autre fichier d'equipes ne donnerait pas les memes tournois.
+*@return L'empreinte.
+*/
+static uint64_t teams_hash(void) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < num_teams; i++) {
+        h = fnv1a(h, &teams.lengths[i], sizeof(uint32_t));
+        h = fnv1a(h, team_name(i), teams.lengths[i]);
+        if (teams.ratings != NULL) {
+            h = fnv1a(h, &teams.ratings[i], sizeof(double));
+        }
+    }
+    return h;
+}
+
+/**
+*@brief Remplit l'en-tete du point de reprise de la simulation.
+*@param h L'en-tete.
+*@param mc La simulation.
+*@param done Le nombre de tournois comptes.
+*@return vide.
+*/
+static void checkpoint_header(CheckpointHeader *h, MonteCarlo *mc, long done) {
+    memset(h, 0, sizeof(CheckpointHeader));
+    memcpy(h->magic, CHECKPOINT_MAGIC, 4);
+    h->version = CHECKPOINT_VERSION;
+    h->seed = mc->seed;
+    h->runs = mc->runs;
+    h->done = done;
+    h->num_teams = mc->num_teams;
+    h->num_rounds = mc->num_rounds;
+    h->match_duration = match_duration;
+    h->engine = options.engine;
+    h->teams_hash = teams_hash();
+}
+
+/**
+*@brief Force sur disque le repertoire qui contient path, pour qu'un renommage dans ce repertoire survive a un arret brutal.
+*@param path Le chemin d'un fichier ; sans '/', le repertoire courant.
+*@return 0, ou -1 si le repertoire n'a pas pu etre ouvert ou synchronise.
+*/
+static int checkpoint_sync_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    size_t len = slash == NULL ? 1 : slash == path ? 1 : (size_t) (slash - path);
+    char *dir = (char*) malloc(len + 1);
+
+    memcpy(dir, slash == NULL ? "." : path, len);
+    dir[len] = '\0';
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    int status = fd >= 0 && fsync(fd) == 0 ? 0 : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(dir);
+    return status;
+}
+
+/**
+*@brief Ecrit un point de reprise : le fichier temporaire path.tmp est projete, rempli, force sur disque par msync, puis renomme en path, et le repertoire est a son tour force sur disque pour que le renommage ne soit pas perdu. Le renommage etant atomique, path contient toujours un point de reprise complet, l'ancien ou le nouveau.
+*@param mc La simulation, dont les compteurs couvrent les tournois 0 a done - 1.
+*@param path Le fichier de reprise.
+*@param done Le nombre de tournois comptes.
+*@return 0, ou -1 en cas d'erreur (la simulation continue, avec le point de reprise precedent).
+*/
+static int checkpoint_write(MonteCarlo *mc, const char *path, long done) {
+    size_t cells = (size_t) mc->num_teams * (mc->num_rounds + 1);
+    size_t size = sizeof(CheckpointHeader) + cells * sizeof(long);
+    size_t len = strlen(path);
+    char *tmp = (char*) malloc(len + 5);
+    int status = -1;
+
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0 && ftruncate(fd, size) == 0) {
+        char *map = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            CheckpointHeader *h = (CheckpointHeader*) map;
+            checkpoint_header(h, mc, done);
+            memcpy(map + sizeof(CheckpointHeader), mc->reached, cells * sizeof(long));
+            h->counters_hash = fnv1a(14695981039346656037ULL, mc->reached, cells * sizeof(long));
+            if (msync(map, size, MS_SYNC) == 0 && rename(tmp, path) == 0) {
+                status = checkpoint_sync_dir(path);
+            }
+            munmap(map, size);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (status < 0) {
+        unlink(tmp);
+    }
+    free(tmp);
+    return status;
+}
+
+/**
+*@brief Charge un point de reprise dans les compteurs de la simulation. Un point de reprise d'une autre configuration (graine, nombre de tournois, equipes, duree, moteur) ou abime est refuse.
+*@param mc La simulation, dont les compteurs sont encore a zero.
+*@param path Le fichier de reprise.
+*@return Le nombre de tournois deja comptes, ou -1 si le fichier n'existe pas.
+*/
+static long checkpoint_load(MonteCarlo *mc, const char *path) {
+    size_t cells = (size_t) mc->num_teams * (mc->num_rounds + 1);
+    size_t size = sizeof(CheckpointHeader) + cells * sizeof(long);
+    struct stat st;
+    CheckpointHeader expected;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size != size) {
+        printf("Point de reprise %s incompatible avec cette simulation.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    const char *map = (const char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Erreur lors de la lecture du fichier %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    const CheckpointHeader *h = (const CheckpointHeader*) map;
+    checkpoint_header(&expected, mc, h->done);
+    expected.counters_hash = h->counters_hash;
+    if (memcmp(h, &expected, sizeof(CheckpointHeader)) != 0 || h->done < 0 || h->done > h->runs) {
+        printf("Point de reprise %s incompatible avec cette simulation (graine, tournois, equipes, duree ou moteur differents).\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (fnv1a(14695981039346656037ULL, map + sizeof(CheckpointHeader), cells * sizeof(long)) != h->counters_hash) {
+        printf("Point de reprise %s abime.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(mc->reached, map + sizeof(CheckpointHeader), cells * sizeof(long));
+    long done = h->done;
+    munmap((void*) map, size);
+    return done;
+}
+
+/**
+*@brief Simule les tournois de la simulation par tranches consecutives, et ecrit un point de reprise des qu'une tranche se termine au moins interval secondes apres le precedent, puis a la fin. La taille des tranches s'ajuste pour durer environ interval secondes : le seul surcout est l'ecriture du point de reprise et la fin de chaque tranche, ou les workers s'attendent.
+*@param mc La simulation, preparee par montecarlo_init.
+*@param pool Le pool de workers.
+*@param path Le fichier de reprise.
+*@param resume 1 pour reprendre a partir de path s'il existe, 0 pour recommencer au premier tournoi.
+*@param interval Le temps minimal entre deux points de reprise, en secondes.
+*@return vide.
+*/
+void checkpoint_run(MonteCarlo *mc, Pool *pool, const char *path, int resume, int interval) {
+    long done = 0;
+    long step = (long) pool->num_workers * 64;
+    double start = now();
+    double last = start;
+    double spent = 0;
+    int written = 0;
+
+    if (resume && (done = checkpoint_load(mc, path)) >= 0) {
+        fprintf(stderr, "Reprise de %s : %ld tournois sur %ld deja simules\n", path, done, mc->runs);
+    } else {
+        done = 0;
+    }
+    while (done < mc->runs) {
+        long count = step < mc->runs - done ? step : mc->runs - done;
+        double t0 = now();
+        montecarlo_range(mc, pool, done, count);
+        done += count;
+        double t1 = now();
+
+        //Tranche suivante d'environ interval secondes, en au plus quadruplant la taille
+        double target = count * interval / (t1 - t0 > 1e-6 ? t1 - t0 : 1e-6);
+        step = target > 4.0 * count ? 4 * count : target < count / 2 ? count / 2 : (long) target;
+        if (step < pool->num_workers) {
+            step = pool->num_workers;
+        }
+        if (t1 - last >= interval || done == mc->runs) {
+            if (checkpoint_write(mc, path, done) < 0) {
+                fprintf(stderr, "Erreur lors de l'ecriture du point de reprise %s.\n", path);
+            } else {
+                written++;
+            }
+            last = now();
+            spent += last - t1;
+        }
+    }
+    fprintf(stderr, "Points de reprise : %d ecrits dans %s, %.3f s (%.2f%% du temps)\n", written, path, spent,
+            100.0 * spent / (now() - start > 1e-9 ? now() - start : 1e-9));
+}
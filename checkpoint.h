@@ -0,0 +1,34 @@
+#ifndef OS_CHECKPOINT_H
+#define OS_CHECKPOINT_H
+
+#include "montecarlo.h"
+
+/**
+ *@brief Fichier de reprise d'une simulation Monte Carlo (--checkpoint) : un en-tete CheckpointHeader suivi des compteurs
+ * MonteCarlo.reached des tournois 0 a done - 1. Les flux aleatoires d'un tournoi ne dependant que de (graine, numero du
+ * tournoi), ces compteurs et done suffisent a reprendre la simulation exactement ou elle s'etait arretee.
+*/
+#define CHECKPOINT_MAGIC "MSCK"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_INTERVAL 30 // secondes entre deux points de reprise, par defaut
+
+/**
+ *@brief En-tete du fichier de reprise : la configuration de la simulation, pour refuser une reprise incompatible
+*/
+typedef struct CheckpointHeader{
+    char magic[4];          // "MSCK"
+    uint32_t version;       // CHECKPOINT_VERSION
+    uint64_t seed;          // graine de la simulation
+    int64_t runs;           // nombre total de tournois
+    int64_t done;           // nombre de tournois deja comptes
+    uint32_t num_teams;
+    uint32_t num_rounds;
+    uint32_t match_duration;
+    uint32_t engine;        // options.engine, dont depend le tirage des resultats
+    uint64_t teams_hash;    // empreinte des noms et classements des equipes, dans l'ordre melange
+    uint64_t counters_hash; // empreinte des compteurs qui suivent l'en-tete
+}CheckpointHeader;
+
+void checkpoint_run(MonteCarlo *mc, Pool *pool, const char *path, int resume, int interval);
+
+#endif
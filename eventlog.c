@@ -0,0 +1,196 @@
+#include "eventlog.h"
+#include "pool.h"
+#include <sched.h>
+
+/**
+ *@brief Taille du tampon de mise en forme du thread de journalisation
+*/
+#define LOG_BUFFER 65536
+
+/**
+ *@brief Journal actif, NULL si les evenements sont affiches directement (mode manuel)
+*/
+EventLog *event_log = NULL;
+
+/**
+*@brief Met en forme un evenement, avec exactement les memes lignes que l'affichage direct d'origine.
+*@param e L'evenement.
+*@param buf Le tampon de destination.
+*@param size La place disponible dans buf.
+*@return Le nombre de caracteres ecrits (tronque a size - 1).
+*/
+static int event_format(Event *e, char *buf, size_t size) {
+    int len = 0;
+
+    switch (e->kind) {
+        case EV_DEBUT:
+            len = snprintf(buf, size, "DEBUT %.*s %d - %d %.*s [TOUR %d]\n", TEAM(e->team1), e->score1, e->score2, TEAM(e->team2), e->tour);
+            break;
+        case EV_BUT:
+            len = snprintf(buf, size, "(%d') %.*s %d - %d %-20.*s\n", e->minute, TEAM_MAX(e->team1, 20), e->score1, e->score2, TEAM(e->team2));
+            break;
+        case EV_TAB:
+            len = snprintf(buf, size, "%.*s (%d) - (%d) %-20.*s\n", TEAM_MAX(e->team1, 20), e->score1, e->score2, TEAM(e->team2));
+            break;
+        case EV_FIN:
+            if (e->score1 > e->score2) {
+                len = snprintf(buf, size, "FIN %.*s* %d - %d %.*s\n", TEAM(e->team1), e->score1, e->score2, TEAM(e->team2));
+            } else if (e->score1 == e->score2) { // match nul, possible seulement en championnat
+                len = snprintf(buf, size, "FIN %.*s %d - %d %.*s\n", TEAM(e->team1), e->score1, e->score2, TEAM(e->team2));
+            } else {
+                len = snprintf(buf, size, "FIN %.*s %d - %d %.*s*\n", TEAM(e->team1), e->score1, e->score2, TEAM(e->team2));
+            }
+            break;
+    }
+    return len < (int) size ? len : (int) size - 1;
+}
+
+/**
+*@brief Place necessaire pour mettre en forme un evenement : les noms ne sont pas tronques, sauf en tete des lignes de but.
+*@param e L'evenement.
+*@return Une borne superieure de la longueur de la ligne, '\0' compris.
+*/
+static size_t event_size(Event *e) {
+    return 96 + teams.lengths[e->team1] + teams.lengths[e->team2];
+}
+
+/**
+*@brief Met en forme un evenement et l'ecrit directement, quelle que soit la longueur des noms.
+*@param e L'evenement.
+*@param out La destination.
+*@return vide.
+*/
+static void event_write(Event *e, FILE *out) {
+    char small[512];
+    size_t size = event_size(e);
+    char *line = size <= sizeof(small) ? small : (char*) malloc(size);
+
+    fwrite(line, 1, event_format(e, line, size), out);
+    if (line != small) {
+        free(line);
+    }
+}
+
+/**
+*@brief Vide tous les tampons dans la sortie : les evenements sont mis en forme dans un tampon local et ecrits par blocs.
+*@param log Le journal.
+*@return Le nombre d'evenements traites.
+*/
+static int eventlog_drain(EventLog *log) {
+    static char buf[LOG_BUFFER]; // utilise uniquement par le thread de journalisation
+    size_t used = 0;
+    int count = 0;
+
+    for (int i = 0; i < log->num_rings; i++) {
+        Ring *r = &log->rings[i];
+        unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+        while (head != tail) {
+            Event *e = &r->events[head & (RING_SIZE - 1)];
+            size_t need = event_size(e);
+            if (LOG_BUFFER - used < need) {
+                fwrite(buf, 1, used, log->out);
+                used = 0;
+            }
+            if (need > LOG_BUFFER) { // noms tres longs : ligne ecrite a part
+                event_write(e, log->out);
+            } else {
+                used += event_format(e, buf + used, LOG_BUFFER - used);
+            }
+            head++;
+            count++;
+        }
+        atomic_store_explicit(&r->head, head, memory_order_release);
+    }
+    if (used > 0) {
+        fwrite(buf, 1, used, log->out);
+        fflush(log->out);
+    }
+    STATS_ADD(events, count);
+    return count;
+}
+
+/**
+*@brief Boucle du thread de journalisation : vide les tampons, et dort un peu plus longtemps a chaque passage a vide (de 50 us a 2 ms).
+*@param arg Le journal.
+*@return NULL
+*/
+static void *eventlog_thread(void *arg) {
+    EventLog *log = (EventLog*) arg;
+    long pause = 50000;
+
+    while (!atomic_load(&log->stop)) {
+        if (eventlog_drain(log) > 0) {
+            pause = 50000;
+        } else {
+            struct timespec ts = {0, pause};
+            nanosleep(&ts, NULL);
+            if (pause < 2000000) {
+                pause *= 2;
+            }
+        }
+    }
+    eventlog_drain(log);
+    return NULL;
+}
+
+/**
+*@brief Demarre le journal asynchrone et le rend actif pour log_event.
+*@param log Le journal.
+*@param num_rings Le nombre de tampons, un par worker du pool.
+*@param out La destination des lignes.
+*@return vide.
+*/
+void eventlog_start(EventLog *log, int num_rings, FILE *out) {
+    log->num_rings = num_rings;
+    log->rings = (Ring*) aligned_alloc(64, num_rings * sizeof(Ring));
+    for (int i = 0; i < num_rings; i++) {
+        atomic_init(&log->rings[i].head, 0);
+        atomic_init(&log->rings[i].tail, 0);
+    }
+    log->out = out;
+    atomic_init(&log->stop, 0);
+    fflush(stdout);
+    pthread_create(&log->thread, NULL, eventlog_thread, log);
+    event_log = log;
+}
+
+/**
+*@brief Arrete le journal apres avoir ecrit tous les evenements restants. Les producteurs doivent avoir termine.
+*@param log Le journal.
+*@return vide.
+*/
+void eventlog_stop(EventLog *log) {
+    atomic_store(&log->stop, 1);
+    pthread_join(log->thread, NULL);
+    event_log = NULL;
+    free(log->rings);
+}
+
+/**
+*@brief Publie un evenement de match. Selon options.quiet, l'evenement peut etre ignore des la source. Depuis un worker, il est copie dans le tampon du worker (en attendant s'il est plein) ; sinon il est affiche immediatement.
+*@param kind La nature de l'evenement.
+*@param match Le match, dont les scores courants sont copies.
+*@param minute La minute du but (EV_BUT), ignoree sinon.
+*@return vide.
+*/
+void log_event(EventKind kind, Match match, int minute) {
+    if (options.quiet >= 2 || (options.quiet == 1 && (kind == EV_BUT || kind == EV_TAB))) {
+        return;
+    }
+    Event e = {match->team1, match->team2, minute, match->tour, match->score1, match->score2, kind};
+    int id = pool_worker_id();
+
+    if (event_log == NULL || id < 0 || id >= event_log->num_rings) {
+        event_write(&e, stdout);
+        STATS_ADD(events, 1);
+        return;
+    }
+    Ring *r = &event_log->rings[id];
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&r->head, memory_order_acquire) == RING_SIZE) {
+        sched_yield(); // tampon plein : on laisse le thread de journalisation le vider
+    }
+    r->events[tail & (RING_SIZE - 1)] = e;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
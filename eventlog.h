@@ -0,0 +1,65 @@
+#ifndef OS_EVENTLOG_H
+#define OS_EVENTLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "fonctions.h"
+
+/**
+ *@brief Nombre d'evenements par tampon circulaire (puissance de 2)
+*/
+#define RING_SIZE 4096
+
+/**
+ *@brief Nature d'un evenement de match, une par type de ligne affichee
+*/
+typedef enum EventKind{
+    EV_DEBUT,   // coup d'envoi
+    EV_BUT,     // but pendant le temps reglementaire
+    EV_TAB,     // tir au but reussi
+    EV_FIN      // coup de sifflet final
+}EventKind;
+
+/**
+ *@brief Evenement binaire de taille fixe, mis en forme plus tard par le thread de journalisation
+*/
+typedef struct Event{
+    int32_t team1;
+    int32_t team2;
+    int32_t minute;
+    int32_t tour;       // comme Match.tour : un championnat compte jusqu'a 2 * (n - 1) journees
+    int16_t score1;
+    int16_t score2;
+    int8_t kind;
+}Event;
+
+/**
+ *@brief Tampon circulaire a un producteur (un worker) et un consommateur (le thread de journalisation), sans verrou.
+ * head et tail sont sur des lignes de cache separees pour eviter le faux partage.
+*/
+typedef struct Ring{
+    _Alignas(64) atomic_uint head;  // prochain evenement a lire, ecrit par le consommateur
+    _Alignas(64) atomic_uint tail;  // prochain emplacement libre, ecrit par le producteur
+    Event events[RING_SIZE];
+}Ring;
+
+/**
+ *@brief Journal asynchrone : un tampon par worker, vide par un unique thread qui met en forme et ecrit par blocs
+*/
+typedef struct EventLog{
+    int num_rings;
+    Ring *rings;
+    FILE *out;          // destination des lignes (stdout ou --log)
+    atomic_int stop;    // demande d'arret du thread de journalisation
+    pthread_t thread;
+}EventLog;
+
+extern EventLog *event_log;
+
+void eventlog_start(EventLog *log, int num_rings, FILE *out);
+void eventlog_stop(EventLog *log);
+void log_event(EventKind kind, Match match, int minute);
+
+#endif
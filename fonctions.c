@@ -1,301 +1,442 @@
 #include "fonctions.h"
+#include "bracket.h"
+#include "eventlog.h"
+#include "live.h"
+#include "table.h"
+#include "results.h"
 
 /**
-*@brief Lit les noms d'équipe à partir d'un fichier et les stocke dans un tableau de chaînes alloué dynamiquement.
-*@param filename Le nom du fichier contenant les noms des équipes.
-*@param num_teams Un pointeur vers un entier qui stockera le nombre d'équipes lues à partir du fichier.
-*@param team_names Un pointeur vers un pointeur qui stockera le tableau des noms d'équipe.
-*@pre Le paramètre filename doit être un chemin d'accès valide vers un fichier contenant des noms d'équipe, et les paramètres num_teams et team_names doivent être non nuls.
-*@post Le paramètre num_teams sera mis à jour avec le nombre d'équipes lues à partir du fichier, et le paramètre team_names pointera vers un tableau de chaînes alloué dynamiquement contenant les noms des équipes.
+ *@brief Chances des matchs pour chaque ecart de classement, de -RATING_MAX_DIFF a RATING_MAX_DIFF
+*/
+static Odds diff_odds[2 * RATING_MAX_DIFF + 1];
+
+/**
+*@brief Ajoute une vue sur un nom d'equipe a la table, en agrandissant l'index si besoin.
+*@param t La table des equipes.
+*@param offset La position du nom dans le fichier.
+*@param len La longueur du nom.
+*@param rating Le classement de l'equipe, NAN si la ligne n'en donne pas.
 *@return vide.
 */
-void read_team_names(char* filename, int* num_teams, char *** team_names) {
-    FILE *file;
-    *team_names = (char**) malloc(MAX_TEAMS * sizeof(char*));
-    char line[MAX_TEAM_NAME_LEN];
+static void add_team(TeamTable *t, size_t offset, size_t len, double rating) {
+    if (t->count == t->cap) {
+        t->cap = t->cap ? 2 * t->cap : 1024;
+        t->offsets = (uint32_t*) realloc(t->offsets, t->cap * sizeof(uint32_t));
+        t->lengths = (uint32_t*) realloc(t->lengths, t->cap * sizeof(uint32_t));
+        t->ratings = (double*) realloc(t->ratings, t->cap * sizeof(double));
+    }
+    t->offsets[t->count] = (uint32_t) offset;
+    t->lengths[t->count] = (uint32_t) len;
+    t->ratings[t->count] = rating;
+    t->count++;
+}
 
-    for (int i = 0; i < MAX_TEAMS; i++) {
-        (*team_names)[i] = (char*) malloc(MAX_TEAM_NAME_LEN * sizeof(char));
+/**
+*@brief Lit le classement dans la colonne qui suit le nom d'une equipe.
+*@param col Le debut de la colonne (apres le ';').
+*@param eol La fin de la ligne.
+*@return Le classement, ou NAN si la colonne est absente ou n'est pas un nombre.
+*/
+static double parse_rating(const char *col, const char *eol) {
+    char buf[32];
+    const char *stop = memchr(col, ';', eol - col);
+    size_t len = (stop != NULL ? stop : eol) - col;
+    double rating;
+
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
     }
+    memcpy(buf, col, len); // la vue n'est pas terminee par '\0'
+    buf[len] = '\0';
+    return sscanf(buf, "%lf", &rating) == 1 && isfinite(rating) ? rating : NAN;
+}
+
+/**
+*@brief Lit les équipes à partir d'un fichier projeté en mémoire, sans copier les noms : chaque nom est une vue (position, longueur) dans le fichier, puis l'ordre des équipes est mélangé en permutant les vues.
+* La première ligne contient la durée des matchs (sinon DURATION est utilisée et la ligne est ignorée). Chaque ligne suivante non vide décrit une équipe : son nom, sans limite de longueur, suivi éventuellement d'autres colonnes séparées par ';', dont la première est le classement Elo de l'équipe ("Nom;1650"). Les espaces en fin de nom sont ignorés.
+* Le nombre d'équipes n'est pas limité ni tenu d'être une puissance de 2 : le tableau du tournoi complète avec des exemptions.
+*@param filename Le nom du fichier contenant les noms des équipes.
+*@param num_teams Un pointeur vers un entier qui stockera le nombre d'équipes lues à partir du fichier.
+*@param teams La table des équipes à remplir ; le fichier reste projeté jusqu'à free_memory.
+*@pre Le paramètre filename doit être un chemin d'accès valide vers un fichier contenant des noms d'équipe, et les paramètres num_teams et teams doivent être non nuls.
+*@post Le paramètre num_teams sera mis à jour avec le nombre d'équipes lues à partir du fichier (au moins 2), et teams contiendra leurs noms dans un ordre aléatoire.
+*@return vide.
+*/
+void read_team_names(char* filename, int* num_teams, TeamTable *teams) {
+    struct stat st;
+    int fd;
+    STATS_START(load);
 
-    file = fopen(filename, "r");
-    if (file == NULL) {
+    memset(teams, 0, sizeof(TeamTable));
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
         printf("Erreur lors de l'ouverture du fichier.");
         exit(1);
     }
+    if (st.st_size > UINT32_MAX) {
+        printf("Fichier trop volumineux.\n");
+        exit(EXIT_FAILURE);
+    }
+    teams->size = st.st_size;
+    if (teams->size > 0) {
+        teams->data = (const char*) mmap(NULL, teams->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (teams->data == MAP_FAILED) {
+            printf("Erreur lors de la lecture du fichier.");
+            exit(1);
+        }
+        madvise((void*) teams->data, teams->size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    const char *data = teams->data;
+    const char *end = data + teams->size;
+    const char *line = data;
 
     // Lecture de la durée du match sur la première ligne
-    fgets(line, sizeof(line), file);
+    const char *eol = line < end ? memchr(line, '\n', end - line) : NULL;
+    if (eol == NULL) {
+        eol = end;
+    }
+    char header[32];
+    size_t header_len = eol - line < (long) sizeof(header) - 1 ? (size_t) (eol - line) : sizeof(header) - 1;
+    memcpy(header, line, header_len);
+    header[header_len] = '\0';
 
     //Verification si une duree est introduite
     int num;
-    if (sscanf(line, "%d", &num) == 1) {
-        match_duration = atoi(line);
+    if (sscanf(header, "%d", &num) == 1) {
+        match_duration = num;
     }else {
         match_duration = DURATION;
     }
 
     // Lecture des noms d'équipes sur les lignes suivantes
-    while (fgets(line, sizeof(line), file)) {
-        // Supprime le caractère de fin de ligne
-        line[strcspn(line, "\r\n")] = 0;
-
-        // Supprime les espaces inutiles à la fin de la chaîne de caractères
-        int len = strlen(line);
-        while (len > 0 && line[len-1] == ' ') {
-            line[len-1] = '\0';
-            len--;
+    for (line = eol + 1; line < end; line = eol + 1) {
+        eol = memchr(line, '\n', end - line);
+        if (eol == NULL) {
+            eol = end;
         }
-
-        // Vérifie si la ligne contient que des vides
-        int only_spaces = 1;
-        for (int i = 0; i < len; i++) {
-            if (line[i] != ' ') {
-                only_spaces = 0;
-                break;
-            }
+        // Le nom s'arrête à la fin de ligne ou à la première colonne supplémentaire
+        const char *stop = memchr(line, ';', eol - line);
+        if (stop == NULL) {
+            stop = eol;
+        }
+        // Supprime le retour chariot et les espaces inutiles à la fin du nom
+        while (stop > line && (stop[-1] == ' ' || stop[-1] == '\r')) {
+            stop--;
         }
 
-        // Si la ligne ne contient pas que des vides, ajoute le nom de l'équipe à la liste
-        if (!only_spaces) {
-            strcpy((*team_names)[*num_teams], line);
-            (*num_teams)++;
+        // Si la ligne ne contient pas que des vides, ajoute l'équipe à la table, avec son classement éventuel
+        if (stop > line) {
+            const char *col = memchr(line, ';', eol - line);
+            add_team(teams, line - data, stop - line, col != NULL ? parse_rating(col + 1, eol) : NAN);
         }
     }
-    if (((*num_teams) & ((*num_teams) - 1)) != 0 || (*num_teams) > MAX_TEAMS)
+    *num_teams = teams->count;
+    if (*num_teams < 2)
     {
-        printf("Number of teams must be a power of 2 and less than %d\n", MAX_TEAMS);
+        printf("At least 2 teams are required\n");
         exit(EXIT_FAILURE);
     }
-    fclose(file);
 
-    // Mélange les noms d'équipes de manière aléatoire
-    srand(time(NULL));
+    // Classements : les equipes sans classement ont RATING_DEFAULT, et la table est abandonnee si aucune n'en a
+    int rated = 0;
+    for (int i = 0; i < *num_teams; i++) {
+        if (isnan(teams->ratings[i])) {
+            teams->ratings[i] = RATING_DEFAULT;
+        } else {
+            rated = 1;
+        }
+    }
+    if (!rated) {
+        free(teams->ratings);
+        teams->ratings = NULL;
+    }
+    for (int d = -RATING_MAX_DIFF; d <= RATING_MAX_DIFF; d++) {
+        odds_from_diff(d, &diff_odds[d + RATING_MAX_DIFF]);
+    }
+
+    STATS_PHASE(STATS_LOAD, load);
+
+    // Mélange l'ordre des équipes avec un flux dédié dérivé de la graine : seules les vues sont échangées
+    STATS_START(shuffle);
+    Rng rng;
+    rng_seed(&rng, options.seed, 0, RNG_STREAM_SHUFFLE);
 
     // Shuffle
     for (int i = *num_teams - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        char temp[MAX_TEAM_NAME_LEN];
-        strcpy(temp, (*team_names)[i]);
-        strcpy((*team_names)[i], (*team_names)[j]);
-        strcpy((*team_names)[j], temp);
+        int j = rng_below(&rng, i + 1);
+        uint32_t temp = teams->offsets[i];
+        teams->offsets[i] = teams->offsets[j];
+        teams->offsets[j] = temp;
+        temp = teams->lengths[i];
+        teams->lengths[i] = teams->lengths[j];
+        teams->lengths[j] = temp;
+        if (teams->ratings != NULL) {
+            double r = teams->ratings[i];
+            teams->ratings[i] = teams->ratings[j];
+            teams->ratings[j] = r;
+        }
     }
+    STATS_PHASE(STATS_SHUFFLE, shuffle);
 }
 /**
-*@brief La fonction simule un match pour le mode "Simulation concurrente", cette fonction s'execute dans un thread, ce qui permet d'executer plusieurs matchs en meme temps avec un mecanisme de verrouillage avec mutex pour eviter les problemes liées aux acces concurrents.
-* Elle simule le match en générant des scores aléatoires pour chaque équipe en utilisant la fonction rand().
-* Le match est simulé pendant un certain temps défini par la constante match_duration, et si les scores sont égaux à la fin du temps réglementaire, une séance de tirs au but est effectuée pour déterminer le vainqueur.
-* Si une équipe gagne le match, la fonction met à jour le tableau teams_remaining qui indique quelles équipes sont encore en compétition et à quel tour. Elle utilise également un verrou (mutex) pour éviter les conflits d'accès au tableau par plusieurs threads en même temps.
-*@param ma Pointeur qui est ensuite casté en une structure Match. Corresspond au match qui va etre simulé
-*@return void*
+*@brief Ecart de classement entre deux equipes, arrondi a l'entier et borne a RATING_MAX_DIFF.
+*@param team1 Numero de l'equipe 1.
+*@param team2 Numero de l'equipe 2.
+*@return Le classement de l'equipe 1 moins celui de l'equipe 2, 0 sans classements.
 */
-void *simulate_match(void *ma)
-{
-    Match match = (Match) ma;
+int rating_diff(int team1, int team2) {
+    if (teams.ratings == NULL) {
+        return 0;
+    }
+    long diff = lround(teams.ratings[team1] - teams.ratings[team2]);
+    return diff > RATING_MAX_DIFF ? RATING_MAX_DIFF : diff < -RATING_MAX_DIFF ? -RATING_MAX_DIFF : (int) diff;
+}
 
-    int duration = 0;
-    int action;
+/**
+*@brief Chances d'un match selon l'ecart de classement, avec le score attendu Elo E = 1 / (1 + 10^(-diff/400)) de l'equipe 1 :
+* les GOAL_PERCENT % de chance de but par minute sont partages en E et 1 - E, et chaque tireur gagne ou perd jusqu'a 10 points de reussite aux tirs au but.
+* A ecart nul, on retrouve exactement les chances d'origine.
+*@param diff L'ecart de classement, entre -RATING_MAX_DIFF et RATING_MAX_DIFF.
+*@param odds Les chances a remplir.
+*@return vide.
+*/
+void odds_from_diff(int diff, Odds *odds) {
+    double e = 1.0 / (1.0 + pow(10.0, -diff / 400.0));
+    odds->goal1 = (int) lround(GOAL_PERCENT * 100 * e);
+    odds->goal2 = GOAL_PERCENT * 100 - odds->goal1;
+    odds->pen1 = (int) lround(7900 + 2000 * (e - 0.5));
+    odds->pen2 = (int) lround(4000 + 2000 * (0.5 - e));
+}
 
-    // Debut de la simulation
-    printf("DEBUT %s %d - %d %s [TOUR %d]\n",team_names[match->team1],match->score1, match->score2,team_names[match->team2],match->tour);
-    while (duration < match_duration)
-    {
-        action = rand() % 100; //Simule une action aleatoire
-        if (action < 98)
-        { // 98% de chance de ne pas marquer pour les deux equipes
-            duration++;
-        }
-        else if (action == 99 )
-        { // 1% de chance de marquer pour l'equipe 1
-            match->score1++;
-            duration++;
-            printf("(%d') %.20s %d - %d %-20s\n",duration, team_names[match->team1], match->score1, match->score2, team_names[match->team2]);
-        }
-        else //action == 100
-        { // 1% de chance de marquer pour l'equipe 2
-            match->score2++;
-            duration++;
-            printf("(%d') %.20s %d - %d %-20s\n",duration, team_names[match->team1], match->score1, match->score2, team_names[match->team2]);
-        }
-        sleep(0.005); //mettre en pause pendant 1 seconde
-    }
-    //Si le score reste nul, alors execution de la séance de tirs au buts
+/**
+*@brief Chances d'un match, lues dans la table precalculee par read_team_names.
+*@param team1 Numero de l'equipe 1.
+*@param team2 Numero de l'equipe 2.
+*@return Les chances du match.
+*/
+const Odds *match_odds(int team1, int team2) {
+    return &diff_odds[rating_diff(team1, team2) + RATING_MAX_DIFF];
+}
+/**
+*@brief Execute la seance de tirs au but d'un match nul : 5 tirs par equipe, puis un tir chacun tant que les scores restent egaux. Les tirs reussis s'ajoutent au score du match.
+*@param match Le match a departager.
+*@param verbose 1 pour publier chaque tir au but reussi dans le journal (log_event), 0 pour une simulation silencieuse.
+*@return vide.
+*/
+void penalty_shootout(Match match, int verbose)
+{
     int nTab = 5;
+    //Sans classement, tirage sur 100 ; avec classements, tirage en dix-milliemes selon les chances du match
+    int scale = 100, miss1 = 21, score2 = 40;
+    if (teams.ratings != NULL) {
+        const Odds *odds = match_odds(match->team1, match->team2);
+        scale = 10000;
+        miss1 = 10000 - odds->pen1;
+        score2 = odds->pen2;
+    }
     while(match->score1 == match->score2){
         int tab;
         while(nTab > 0){
-            tab = rand() % 100;
-            if(tab > 20){ //80% de chance de marquer
+            tab = rng_below(&match->rng, scale);
+            if(tab >= miss1){ //80% de chance de marquer
                 match->score1++;
-                printf("%.20s (%d) - (%d) %-20s\n", team_names[match->team1], match->score1, match->score2, team_names[match->team2]);
+                if (verbose) log_event(EV_TAB, match, 0);
             }
-            tab = rand() % 100;
-            if(tab < 40){//60% de chance de marquer
+            tab = rng_below(&match->rng, scale);
+            if(tab < score2){//60% de chance de marquer
                 match->score2++;
-                printf("%.20s (%d) - (%d) %-20s\n", team_names[match->team1], match->score1, match->score2, team_names[match->team2]);
+                if (verbose) log_event(EV_TAB, match, 0);
             }
             nTab--;
         } //Si apres les 5 TAB, le score reste vierge, alors chacune des deux equipes tir une fois, la premiere qui rate perd le match
         nTab=1;
     }
+}
+/**
+*@brief Joue une minute du temps reglementaire de reference : une action aleatoire est tiree, 98 % de chance sans but, 1 % de but pour chaque equipe.
+* Avec des classements, l'action est tiree en dix-milliemes et les chances de but sont celles du match (match_odds).
+*@param match Le match en cours, ses scores sont mis a jour.
+*@param minute La minute jouee, de 1 a match_duration.
+*@param verbose 1 pour publier un but dans le journal, 0 pour une simulation silencieuse.
+*@return vide.
+*/
+void play_minute(Match match, int minute, int verbose)
+{
+    int scale = 100, goal1 = 1, goal2 = 1;
+    if (teams.ratings != NULL) {
+        const Odds *odds = match_odds(match->team1, match->team2);
+        scale = 10000;
+        goal1 = odds->goal1;
+        goal2 = odds->goal2;
+    }
+    int action = rng_below(&match->rng, scale); //Simule une action aleatoire
+    if (action < scale - goal1 - goal2)
+    { // 98% de chance de ne pas marquer pour les deux equipes
+        return;
+    }
+    else if (action >= scale - goal1)
+    { // 1% de chance de marquer pour l'equipe 1
+        match->score1++;
+    }
+    else
+    { // 1% de chance de marquer pour l'equipe 2
+        match->score2++;
+    }
+    if (verbose) log_event(EV_BUT, match, minute);
+}
+/**
+*@brief Temps reglementaire de reference : une action aleatoire est tiree pour chaque minute simulee, sans attente (le rythme reel des matchs est donne par l'horloge du mode --live).
+*@param match Le match a jouer, ses scores sont mis a jour.
+*@param verbose 1 pour publier les buts dans le journal, 0 pour une simulation silencieuse.
+*@return vide.
+*/
+static void regulation_minute(Match match, int verbose)
+{
+    for (int duration = 1; duration <= match_duration; duration++) {
+        play_minute(match, duration, verbose);
+    }
+}
+/**
+*@brief Temps reglementaire par saut d'evenements, de meme loi que regulation_minute : chaque minute voit un but avec une probabilite GOAL_PERCENT %, donc l'intervalle entre deux buts suit une loi geometrique, et chaque but revient a l'une ou l'autre equipe avec une chance sur deux.
+* Le cout est proportionnel au nombre de buts (environ 2 tirages par match) au lieu du nombre de minutes.
+*@param match Le match a jouer, ses scores sont mis a jour.
+*@param verbose 1 pour publier les buts dans le journal, 0 pour une simulation silencieuse.
+*@return vide.
+*/
+static void regulation_skip(Match match, int verbose)
+{
+    double log_no_goal = log1p(-GOAL_PERCENT / 100.0); // log(1 - p)
+    const Odds *odds = teams.ratings != NULL ? match_odds(match->team1, match->team2) : NULL;
+    int duration = 0;
+
+    while (1) {
+        // Minute du prochain but : 1 + nombre de minutes sans but, tire par inversion de la loi geometrique
+        duration += 1 + (int) (log1p(-rng_uniform(&match->rng)) / log_no_goal);
+        if (duration > match_duration) {
+            break;
+        }
+        // Le but revient a l'equipe 1 avec la probabilite goal1 / (goal1 + goal2), une chance sur deux sans classement
+        if (odds != NULL ? (int) rng_below(&match->rng, odds->goal1 + odds->goal2) < odds->goal1 : rng_below(&match->rng, 2) == 0) {
+            match->score1++;
+        } else {
+            match->score2++;
+        }
+        if (verbose) log_event(EV_BUT, match, duration);
+    }
+}
+/**
+*@brief Deroule le temps reglementaire seul avec le moteur choisi (options.engine) : le match peut rester nul, comme dans un championnat. Le moteur par lots n'existant qu'en Monte Carlo a elimination directe, il utilise ici le moteur minute.
+*@param match Le match a jouer, ses scores sont mis a jour.
+*@param verbose 1 pour publier les buts dans le journal, 0 pour une simulation silencieuse. Le moteur par tables ne publie aucun but.
+*@return vide.
+*/
+void run_regulation(Match match, int verbose)
+{
+    if (options.engine == ENGINE_TABLE) {
+        table_regulation(&outcomes, match);
+    } else if (options.engine == ENGINE_SKIP) {
+        regulation_skip(match, verbose);
+    } else {
+        regulation_minute(match, verbose);
+    }
+}
+/**
+*@brief Deroule un match complet : temps reglementaire avec le moteur choisi (options.engine), puis tirs au but en cas d'egalite. Le moteur par tables tire directement le resultat final, tirs au but compris, sans publier les buts. Cette fonction ne touche a aucune donnee partagee : elle est utilisee par la simulation concurrente et par le mode Monte Carlo.
+*@param match Le match a jouer, ses scores sont mis a jour.
+*@param verbose 1 pour publier les buts dans le journal (mode concurrent), 0 pour une simulation silencieuse.
+*@return Le numero de l'equipe gagnante.
+*/
+int run_match(Match match, int verbose)
+{
+    if (options.engine == ENGINE_TABLE) {
+        return table_match(&outcomes, match);
+    }
+    run_regulation(match, verbose);
+    //Si le score reste nul, alors execution de la séance de tirs au buts
+    penalty_shootout(match, verbose);
+
+    return match->score1 > match->score2 ? match->team1 : match->team2;
+}
+/**
+*@brief Publie le resultat d'un match concurrent termine : sous le mutex global, le tableau teams_remaining est mis a jour et le vainqueur est qualifie dans le tableau du tournoi (bracket_report).
+* Le match est d'abord ajoute au fichier binaire de resultats s'il est actif, hors du mutex : l'ecriture d'un tampon plein sur le disque ne bloque pas les autres matchs. Elle a lieu avant bracket_report pour que le dernier match soit enregistre avant que le thread principal, reveille a la fin du tournoi, ferme le fichier.
+*@param match Le match termine, qui doit appartenir a bracket.matchs.
+*@return vide.
+*/
+void report_match(Match match)
+{
+    if (results != NULL) {
+        results_record(results, 0, match - bracket.matchs, match);
+    }
     if(match->score1 > match->score2){ // Si l'équipe 1 a gagné
-        pthread_mutex_lock(&mutex); // Verrouillage du mutex pour accéder à la variable partagée
+        STATS_LOCK(&mutex); // Verrouillage du mutex pour accéder à la variable partagée
         teams_remaining[match->team1] = match->tour+1; // On met à jour le tableau des équipes restantes en compétition
         teams_remaining[match->team2] = -1; // On indique que l'équipe 2 est éliminée
+        bracket_report(&bracket, match, match->team1); // Le vainqueur est qualifié pour le match suivant du tableau
         pthread_mutex_unlock(&mutex); // Déverrouillage du mutex
-        printf("FIN %s* %d - %d %s\n",team_names[match->team1], match->score1, match->score2, team_names[match->team2]); // On affiche le résultat du match avec une astérisque à côté du nom de l'équipe gagnante
     }
     else{ // Si l'équipe 2 a gagné ou s'il y a match nul
-        pthread_mutex_lock(&mutex); // Verrouillage du mutex pour accéder à la variable partagée
+        STATS_LOCK(&mutex); // Verrouillage du mutex pour accéder à la variable partagée
         teams_remaining[match->team2] = match->tour+1; // On met à jour le tableau des équipes restantes en compétition
         teams_remaining[match->team1] = -1; // On indique que l'équipe 1 est éliminée
+        bracket_report(&bracket, match, match->team2); // Le vainqueur est qualifié pour le match suivant du tableau
         pthread_mutex_unlock(&mutex); // Déverrouillage du mutex
-        printf("FIN %s %d - %d %s*\n",team_names[match->team1], match->score1, match->score2, team_names[match->team2]); // On affiche le résultat du match avec une astérisque à côté du nom de l'équipe gagnante
     }
-
-    pthread_exit(0);
 }
 /**
-*@brief Simule un match pour le mode manuel, la fonction propose à l'utilisateur de choisir entre : [1] Simuler le deroulement du match en temps reel minute par minute, avec possibilité d'interruption en cliquant sur une touche afin de choisir quelle equipe marque [2]: Choisir directement un score pour le match
-*@param ma Pointeur sur la structure Match
+*@brief La fonction simule un match pour le mode "Simulation concurrente", cette fonction s'execute comme tache sur un worker du pool, ce qui permet d'executer plusieurs matchs en meme temps avec un mecanisme de verrouillage avec mutex pour eviter les problemes liées aux acces concurrents.
+* Le match lui-même est déroulé par run_match avec le flux aléatoire propre au match (match->rng) : pendant match_duration minutes, puis aux tirs au but si les scores sont égaux.
+* Si une équipe gagne le match, la fonction met à jour le tableau teams_remaining qui indique quelles équipes sont encore en compétition et à quel tour. Elle utilise également un verrou (mutex) pour éviter les conflits d'accès au tableau par plusieurs threads en même temps.
+* Les lignes DEBUT, buts, tirs au but et FIN ne sont pas affichees par le worker : elles sont publiees dans le journal asynchrone (log_event).
+* Sous ce meme verrou, le vainqueur est publie dans le tableau du tournoi (bracket_report), ce qui met le match du tour suivant dans la file des matchs prets des que les deux equipes sont connues.
+*@param ma Pointeur qui est ensuite casté en une structure Match. Corresspond au match qui va etre simulé
 *@return void*
 */
-void play_match(Match match){
-    int valid = 0; //choix valide ou pas
-    int sleep = 1000000; //temps d'arret a chaque boucle, en microsecondes
-    int action;
-    int mode ; //Choix du mode de simulation manuel
-    int res = -1;
-
-    printf("Match %s VS %s [TOUR %d]\n",team_names[match->team1],team_names[match->team2],match->tour);
-    do {
-        printf("Choisir le mode de jeu : [1]:Simuler | [2]:Choisir un score \n");
-        scanf("%d",&mode);
-    }while(mode != 1 && mode != 2);
-
-    if(mode==1){ //Mode "Simuler"
-        printf("DEBUT %s %d - %d %s [TOUR %d]\n",team_names[match->team1],match->score1, match->score2,team_names[match->team2],match->tour);
-        for (int duration = 0; duration <= 90; duration++) {
-            usleep(sleep);
-            // Check for input
-            fd_set set;
-            FD_ZERO(&set);
-            FD_SET(STDIN_FILENO, &set);
-            struct timeval timeout = {0, 0};
-            int rv = select(STDIN_FILENO + 1, &set, NULL, NULL, &timeout);
-            if (rv == 1) {
-                getchar();
-                printf("Que voulez-vous faire ? (0: Accelerer le match, 1: L'equipe 1 marque, 2: L'equipe 2 marque) ");
-                duration++;
-                valid=0;
-                res=-1;
-                while(valid==0){
-                    int c;
-                    while ((c = getchar()) != '\n' && c != EOF) {}
-                    scanf("%d",&res);
-                    if(res==0){
-                        sleep = 0; //accelerer le match en mettant le temps d'arret a chaque boucle a 0
-                        valid = 1;
-                    }else if(res==1){ //l'equipe 1 marque
-                        match->score1++;
-                        printf("(%d') %.20s %d - %d %-20s\n",duration, team_names[match->team1], match->score1, match->score2,
-                               team_names[match->team2]);
-                        valid = 1;
-                    }else if(res==2){//l'equipe 2 marque
-                        match->score2++;
-                        printf("(%d') %.20s %d - %d %-20s\n",duration, team_names[match->team1], match->score1, match->score2,
-                               team_names[match->team2]);
-                        valid = 1;
-                    }else{printf("Veuillez choisir entre 0, 1 et 2\n");}
-                }
-            }else{
-                action = rand() % 100; // Simule une action aleatoire
-                if (action < 98) { // 98% de chance de ne pas marquer
-                    printf("(%d')\n", duration);
-                } else if (action == 99) { // 1% de chance de marquer pour l'equipe 1
-                    match->score1++;
-                    printf("(%d') %.20s %d - %d %-20s\n", duration, team_names[match->team1], match->score1, match->score2,
-                           team_names[match->team2]);
-                } else //action == 100
-                { // 1% de chance de marquer pour l'equipe 2
-                    match->score2++;
-                    printf("(%d') %.20s %d - %d %-20s\n", duration, team_names[match->team1], match->score1, match->score2,
-                           team_names[match->team2]);
-                }
-            }
-        }
-        //Si le score reste nul, alors execution de la séance de tirs au buts
-        int nTab = 5;
-        while (match->score1 == match->score2) {
-            int tab;
-            while (nTab > 0) {
-                tab = rand() % 100;
-                if (tab > 20) { //80% de chance de marquer
-                    match->score1++;
-                    printf("%.20s (%d) - (%d) %-20s\n", team_names[match->team1], match->score1, match->score2,
-                           team_names[match->team2]);
-                }
-                tab = rand() % 100;
-                if (tab < 40) {//60% de chance de marquer
-                    match->score2++;
-                    printf("%.20s (%d) - (%d) %-20s\n", team_names[match->team1], match->score1, match->score2,
-                           team_names[match->team2]);
-                }
-                nTab--;
-            }
-            nTab = 1; //Si apres les 5 TAB, le score reste vierge, alors chacune des deux equipes tir une fois, la premiere qui rate perd le match
-        }
-    }
+void *simulate_match(void *ma)
+{
+    Match match = (Match) ma;
+    STATS_START(start);
 
-    if(mode==2){ //Mode "Choisir un score"
-        int score1 = 0, score2 = 0;
-        do {
-            printf("Score %s: ",team_names[match->team1]);
-            scanf("%d",&score1);
-            printf("Score %s: ",team_names[match->team2]);
-            scanf("%d",&score2);
-            if(score1 == score2){
-                printf("Veuillez choisir un score non nul \n");
-            }
-        }while(score1 <= 0 || score2 <= 0 || score1==score2);
-        match->score1 = score1;
-        match->score2 = score2;
-    }
+    // Debut de la simulation
+    log_event(EV_DEBUT, match, 0);
+    run_match(match, 1);
+    report_match(match);
+    STATS_ROUND(match->tour, start);
+    log_event(EV_FIN, match, 0); // Le résultat du match est affiché avec une astérisque à côté du nom de l'équipe gagnante
 
-    if(match->score1 > match->score2){
-        teams_remaining[match->team1] = match->tour+1;
-        teams_remaining[match->team2] = -1;
-        printf("FIN %s* %d - %d %s\n",team_names[match->team1], match->score1, match->score2, team_names[match->team2]);
-    }
-    else{
-        teams_remaining[match->team2] = match->tour+1;
-        teams_remaining[match->team1] = -1;
-        printf("FIN %s %d - %d %s*\n",team_names[match->team1], match->score1, match->score2, team_names[match->team2]);
-    }
+    return NULL;
 }
 /**
  *@brief Enregistre les informations des matchs dans un fichier texte.
  Cette fonction ouvre un fichier texte en mode écriture, puis écrit les informations
  de chaque match dans le fichier sous la forme suivante :
  "Match [numéro] : [nom de l'équipe 1] ([score de l'équipe 1]) : ([score de l'équipe 2]) [nom de l'équipe 2] | Tour [numéro du tour]"
- Les informations sont extraites du tableau "matchs" et du tableau "team_names".
+ Les informations sont extraites du tableau "matchs" et de la table des équipes.
+ Les exemptions (team2 == -1) ne sont pas des matchs joués et ne sont pas écrites.
  Le fichier est ensuite fermé avant la fin de la fonction.
- *@param team_names Le tableau de noms des équipes.
- *@param matchs Le tableau de matchs à enregistrer.
- *@param num_match Le nombre de matchs à enregistrer.
+ *@param filename Le chemin du fichier texte (--output, matchs.txt par défaut).
+ *@param matchs Le tableau contigu des matchs à enregistrer, dans l'ordre du tableau du tournoi.
+ *@param num_match Le nombre de cases du tableau, exemptions comprises.
  *@return void
 */
-void save_matchs(char **team_names, Match *matchs, int num_match) {
+void save_matchs(const char *filename, Match matchs, int num_match) {
     // Ouverture du fichier en mode écriture
-    FILE *fp = fopen("matchs.txt", "w");
+    FILE *fp = fopen(filename, "w");
     if (fp == NULL) {
         printf("Erreur d'ouverture du fichier.");
         return;
     }
 
     // Écriture des informations de chaque match dans le fichier texte
+    int played = 0;
     for (int i = 0; i < num_match; i++) {
-        fprintf(fp, "Match %d : %s [%d] : [%d] %s | Tour %d\n", i + 1, team_names[matchs[i]->team1], matchs[i]->score1, matchs[i]->score2, team_names[matchs[i]->team2], matchs[i]->tour);
+        if (matchs[i].team2 < 0) {
+            continue;
+        }
+        played++;
+        fprintf(fp, "Match %d : %.*s [%d] : [%d] %.*s | Tour %d\n", played, TEAM(matchs[i].team1), matchs[i].score1, matchs[i].score2, TEAM(matchs[i].team2), matchs[i].tour);
     }
 
     fclose(fp); //Fermeture du fichier
@@ -306,11 +447,13 @@ Cette fonction libère la mémoire utilisée pour les noms d'équipe et le table
 @retour vide
 */
 void free_memory() {
-    //Liberation du tableau des noms des equipes
-    for (int i = 0; i < num_teams; i++) {
-        free(team_names[i]);
+    //Liberation de la table des equipes et du fichier projete
+    if (teams.size > 0) {
+        munmap((void*) teams.data, teams.size);
     }
-    free(team_names);
+    free(teams.offsets);
+    free(teams.lengths);
+    free(teams.ratings);
     //Liberation du tableau des equipes restantes
     free(teams_remaining);
 }
@@ -7,34 +7,144 @@
 #include <unistd.h>
 #include <string.h>
 #include <time.h>
+#include <math.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <termios.h>
 #include <sys/select.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include "rng.h"
+#include "stats.h"
 
-#define MAX_TEAMS 64 // nombre max des equipes
-#define MAX_TEAM_NAME_LEN 50 //taille de nom d'equipes
 #define DURATION 90 // default match duration is 90 minutes, equivalent to 5400sec
 #define FILENAME "equipe.txt"
+#define GOAL_PERCENT 2 // chance (en %) qu'un but soit marque pendant une minute, partagee egalement entre les deux equipes
+#define RATING_DEFAULT 1500 // classement Elo d'une equipe sans colonne de classement
+#define RATING_MAX_DIFF 800 // ecart de classement maximal pris en compte (au-dela, 99% des buts pour la meilleure equipe)
+
+/**
+ *@brief Moteur de simulation du temps reglementaire (--engine)
+*/
+typedef enum Engine{
+    ENGINE_MINUTE, // reference : un tirage par minute simulee
+    ENGINE_SKIP,   // saut d'evenements : tirage geometrique de l'intervalle entre deux buts
+    ENGINE_BATCH,  // lots SoA vectorises (batch.c) en mode Monte Carlo ; un match isole utilise le moteur minute
+    ENGINE_TABLE   // tirage direct du resultat dans des tables d'alias precalculees (table.c)
+}Engine;
+
+/**
+ *@brief Table des equipes : le fichier des equipes est projete en memoire (mmap) et chaque nom est
+ * une vue (offsets[i], lengths[i]) dans ce fichier, sans copie. Les noms ne sont donc pas termines
+ * par '\0' : ils s'affichent avec "%.*s" et la macro TEAM.
+ * Une ligne peut contenir d'autres colonnes apres le nom, separees par ';' : la premiere est le
+ * classement Elo de l'equipe. Si aucune equipe n'a de classement, ratings vaut NULL et les chances
+ * d'origine (1% de but par minute pour chaque equipe) sont utilisees telles quelles.
+*/
+typedef struct TeamTable{
+    const char *data;   // contenu du fichier projete
+    size_t size;        // taille du fichier
+    uint32_t *offsets;  // position du nom de chaque equipe dans data
+    uint32_t *lengths;  // longueur du nom de chaque equipe
+    int count;          // nombre d'equipes
+    int cap;            // capacite de offsets et lengths
+    double *ratings;    // classement Elo de chaque equipe, NULL si le fichier n'en donne aucun
+}TeamTable;
+
+/**
+ *@brief Chances d'un match, en dix-milliemes : but de chaque equipe pendant une minute, et tir au but reussi de chaque equipe.
+ * Sans classement, goal1 = goal2 = 100 (1%), pen1 = 7900 et pen2 = 4000 comme dans penalty_shootout.
+*/
+typedef struct Odds{
+    int goal1;
+    int goal2;
+    int pen1;
+    int pen2;
+}Odds;
 
 extern int match_duration;
 extern int num_teams;
-extern char **team_names;
+extern TeamTable teams;
 extern int * teams_remaining;
 extern pthread_mutex_t mutex;
 
+/**
+ *@brief Format du fichier de resultats : resume texte ecrit a la fin, ou enregistrements binaires ecrits au fil des matchs (voir results.h)
+*/
+typedef enum Format{
+    FORMAT_TEXT,
+    FORMAT_BINARY
+}Format;
+
+/**
+ *@brief Options de la ligne de commande
+*/
+typedef struct Options{
+    int threads; // nombre de workers du pool (--threads), par defaut le nombre de coeurs
+    uint64_t seed; // graine du generateur (--seed), par defaut l'heure courante
+    long runs; // nombre de tournois du mode Monte Carlo (--runs), 0 pour un seul tournoi interactif
+    Engine engine; // moteur du temps reglementaire (--engine minute|skip|batch|table)
+    int quiet; // niveau de silence (--quiet[=N]) : 0 tout, 1 sans buts ni tirs au but, 2 aucun evenement
+    char *log; // fichier de destination des evenements (--log), NULL pour la sortie standard
+    Format format; // format des resultats (--format text|binary)
+    char *output; // fichier des resultats (--output), par defaut matchs.txt ou matchs.bin selon le format
+    long live; // duree reelle d'une minute simulee en ms (--live[=MS]), 0 pour simuler sans attendre
+    int analytic; // probabilites exactes du tableau (--analytic), mises a jour apres chaque match du mode manuel
+    char *checkpoint; // fichier de reprise du Monte Carlo (--checkpoint), NULL sans point de reprise
+    int resume; // reprise a partir du fichier de --checkpoint (--resume)
+    int interval; // secondes entre deux points de reprise (--checkpoint-interval)
+    int shards; // nombre de processus du Monte Carlo (--shards), 0 pour un seul processus
+    char *serve; // socket Unix du mode serveur (--serve), NULL pour une execution unique
+    int league; // championnat aller-retour au lieu de l'elimination directe (--league), --runs donnant le nombre de saisons
+}Options;
+
+extern Options options;
+
 typedef struct Match{
     int team1;
     int team2;
     int score1;
     int score2;
     int tour;
+    Rng rng; // flux aleatoire propre au match, derive de (graine, tournoi, indice du match)
 }*Match;
 
-void read_team_names(char* filename, int* num_teams, char *** team_names);
+/**
+ *@brief Nom de l'equipe i, non termine par '\0' (voir team_len)
+*/
+static inline const char *team_name(int i) {
+    return teams.data + teams.offsets[i];
+}
+
+/**
+ *@brief Longueur du nom de l'equipe i, limitee a max
+*/
+static inline int team_len(int i, int max) {
+    return (int) teams.lengths[i] < max ? (int) teams.lengths[i] : max;
+}
+
+/**
+ *@brief Arguments de "%.*s" pour le nom complet de l'equipe i
+*/
+#define TEAM(i) team_len((i), INT32_MAX), team_name(i)
+
+/**
+ *@brief Arguments de "%.*s" pour le nom de l'equipe i tronque a max caracteres (equivalent de "%.20s")
+*/
+#define TEAM_MAX(i, max) team_len((i), (max)), team_name(i)
+
+void read_team_names(char* filename, int* num_teams, TeamTable *teams);
+int rating_diff(int team1, int team2);
+void odds_from_diff(int diff, Odds *odds);
+const Odds *match_odds(int team1, int team2);
+void penalty_shootout(Match match, int verbose);
+void play_minute(Match match, int minute, int verbose);
+void run_regulation(Match match, int verbose);
+int run_match(Match match, int verbose);
+void report_match(Match match);
 void *simulate_match(void *ma);
-void play_match(Match match);
-void save_matchs(char **team_names, Match *matchs, int num_match);
+void save_matchs(const char *filename, Match matchs, int num_match);
 void free_memory();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,392 @@
+#include "league.h"
+#include "eventlog.h"
+
+/**
+ *@brief Tranche d'une journee de la saison unique, simulee par une tache du pool
+*/
+typedef struct Slice{
+    League *l;
+    int day;            // journee, de 0 a num_days - 1
+    int first;          // premier match de la tranche
+    int last;           // dernier match de la tranche (exclu)
+    Standing **partial; // classements propres a chaque worker, fusionnes a la fin de la saison
+}Slice;
+
+/**
+ *@brief Lot de saisons du Monte Carlo, avec les compteurs propres a chaque worker
+*/
+typedef struct Season{
+    League *l;
+    long first;         // premiere saison du lot
+    long last;          // derniere saison du lot (exclue)
+    long **titles;
+    long **points;
+    long **ranks;
+}Season;
+
+/**
+ *@brief Criteres de classement d'une equipe : points, puis difference de buts, puis buts marques
+*/
+typedef struct Rank{
+    int points;
+    int diff;
+    int goals_for;
+    int team;
+}Rank;
+
+/**
+*@brief Match d'une journee par la methode du cercle : l'equipe size - 1 reste fixe, les autres tournent d'un cran a chaque journee. La phase retour inverse domicile et exterieur.
+*@param l Le championnat.
+*@param day La journee, de 0 a num_days - 1.
+*@param i L'indice du match dans la journee, de 0 a size/2 - 1.
+*@param home Recoit l'equipe qui recoit (equipe 1).
+*@param away Recoit l'equipe qui se deplace (equipe 2). Si l'une des deux vaut num_teams, le match est une exemption.
+*@return vide.
+*/
+void league_fixture(League *l, int day, int i, int *home, int *away) {
+    int n = l->size;
+    int d = day % (n - 1);
+    int a = i == 0 ? n - 1 : (d + i) % (n - 1);
+    int b = (d + n - 1 - i) % (n - 1);
+    //L'equipe fixe alterne domicile et exterieur d'une journee a l'autre
+    int swap = (i == 0 ? d : i) & 1;
+
+    if (day >= n - 1) {
+        swap = !swap;
+    }
+    *home = swap ? b : a;
+    *away = swap ? a : b;
+}
+
+/**
+*@brief Reporte le resultat d'un match dans un classement.
+*@param t Le classement.
+*@param m Le match termine.
+*@return vide.
+*/
+static void league_record(Standing *t, Match m) {
+    Standing *h = &t[m->team1];
+    Standing *a = &t[m->team2];
+
+    h->played++;
+    a->played++;
+    h->goals_for += m->score1;
+    h->goals_against += m->score2;
+    a->goals_for += m->score2;
+    a->goals_against += m->score1;
+    if (m->score1 > m->score2) {
+        h->won++;
+        a->lost++;
+        h->points += 3;
+    } else if (m->score1 < m->score2) {
+        a->won++;
+        h->lost++;
+        a->points += 3;
+    } else {
+        h->drawn++;
+        a->drawn++;
+        h->points++;
+        a->points++;
+    }
+}
+
+/**
+*@brief Joue un match du calendrier, sans toucher a aucune donnee partagee.
+*@param l Le championnat.
+*@param season La saison, qui choisit le flux aleatoire.
+*@param day La journee.
+*@param i L'indice du match dans la journee.
+*@param m Le match a remplir.
+*@param verbose 1 pour publier les evenements du match dans le journal, 0 pour une simulation silencieuse.
+*@return 0 si le match est une exemption, 1 sinon.
+*/
+static int league_play(League *l, long season, int day, int i, Match m, int verbose) {
+    league_fixture(l, day, i, &m->team1, &m->team2);
+    if (m->team1 >= l->num_teams || m->team2 >= l->num_teams) {
+        return 0;
+    }
+    m->score1 = 0;
+    m->score2 = 0;
+    m->tour = day + 1;
+    rng_seed(&m->rng, l->seed, season, (uint64_t) day * (l->size / 2) + i);
+    if (verbose) log_event(EV_DEBUT, m, 0);
+    run_regulation(m, verbose);
+    if (verbose) log_event(EV_FIN, m, 0);
+    return 1;
+}
+
+/**
+*@brief Simule une tranche de journee de la saison unique, dans le classement partiel du worker : aucun verrou.
+*@param arg Pointeur sur la Slice a simuler.
+*@return NULL
+*/
+static void *league_slice(void *arg) {
+    Slice *s = (Slice*) arg;
+    Standing *t = s->partial[pool_worker_id()];
+    struct Match m;
+    uint64_t played = 0;
+
+    for (int i = s->first; i < s->last; i++) {
+        if (league_play(s->l, 0, s->day, i, &m, 1)) {
+            league_record(t, &m);
+            played++;
+        }
+    }
+    STATS_ADD(matches, played);
+    return NULL;
+}
+
+/**
+*@brief Compare deux equipes par points, difference de buts et buts marques decroissants, puis par numero d'equipe.
+*@param a Pointeur sur le premier Rank.
+*@param b Pointeur sur le second Rank.
+*@return Un entier negatif, nul ou positif, comme pour qsort.
+*/
+static int compare_ranks(const void *a, const void *b) {
+    const Rank *ra = (const Rank*) a;
+    const Rank *rb = (const Rank*) b;
+    if (ra->points != rb->points) {
+        return ra->points < rb->points ? 1 : -1;
+    }
+    if (ra->diff != rb->diff) {
+        return ra->diff < rb->diff ? 1 : -1;
+    }
+    if (ra->goals_for != rb->goals_for) {
+        return ra->goals_for < rb->goals_for ? 1 : -1;
+    }
+    return ra->team - rb->team;
+}
+
+/**
+*@brief Trie les equipes d'un classement : points, difference de buts, buts marques, puis numero d'equipe. Le tri ne depend d'aucune variable globale et peut etre fait par plusieurs workers a la fois.
+*@param t Le classement.
+*@param num_teams Le nombre d'equipes.
+*@param order Le tableau a remplir, de num_teams places.
+*@return vide.
+*/
+static void league_rank(Standing *t, int num_teams, Rank *order) {
+    for (int i = 0; i < num_teams; i++) {
+        order[i].points = t[i].points;
+        order[i].diff = t[i].goals_for - t[i].goals_against;
+        order[i].goals_for = t[i].goals_for;
+        order[i].team = i;
+    }
+    qsort(order, num_teams, sizeof(Rank), compare_ranks);
+}
+
+/**
+*@brief Simule un lot de saisons completes sans affichage, journee par journee, puis compte le titre, les points et la place finale de chaque equipe dans les compteurs du worker.
+*@param arg Pointeur sur la Season a simuler.
+*@return NULL
+*/
+static void *league_seasons(void *arg) {
+    Season *c = (Season*) arg;
+    League *l = c->l;
+    int w = pool_worker_id();
+    Standing *t = (Standing*) malloc(l->num_teams * sizeof(Standing));
+    Rank *order = (Rank*) malloc(l->num_teams * sizeof(Rank));
+    struct Match m;
+
+    for (long s = c->first; s < c->last; s++) {
+        memset(t, 0, l->num_teams * sizeof(Standing));
+        for (int day = 0; day < l->num_days; day++) {
+            for (int i = 0; i < l->size / 2; i++) {
+                if (league_play(l, s, day, i, &m, 0)) {
+                    league_record(t, &m);
+                }
+            }
+        }
+        league_rank(t, l->num_teams, order);
+        c->titles[w][order[0].team]++;
+        for (int r = 0; r < l->num_teams; r++) {
+            c->points[w][order[r].team] += t[order[r].team].points;
+            c->ranks[w][order[r].team] += r + 1;
+        }
+    }
+    STATS_ADD(matches, (uint64_t) (c->last - c->first) * l->num_teams * (l->num_teams - 1));
+    free(order);
+    free(t);
+    return NULL;
+}
+
+/**
+*@brief Prepare un championnat.
+*@param l Le championnat a initialiser.
+*@param num_teams Le nombre d'equipes, au moins 2.
+*@param seasons Le nombre de saisons du Monte Carlo, 0 pour une saison unique detaillee.
+*@param seed La graine globale.
+*@return vide.
+*/
+void league_init(League *l, int num_teams, long seasons, uint64_t seed) {
+    l->num_teams = num_teams;
+    l->size = num_teams + (num_teams & 1);
+    l->num_days = 2 * (l->size - 1);
+    l->seasons = seasons;
+    l->seed = seed;
+    l->table = (Standing*) calloc(num_teams, sizeof(Standing));
+    l->titles = (long*) calloc(num_teams, sizeof(long));
+    l->points = (long*) calloc(num_teams, sizeof(long));
+    l->ranks = (long*) calloc(num_teams, sizeof(long));
+}
+
+/**
+*@brief Additionne des compteurs par worker dans un total, puis libere les compteurs.
+*@param total Le total.
+*@param partial Les compteurs des workers.
+*@param num_workers Le nombre de workers.
+*@param count La taille de chaque compteur.
+*@return vide.
+*/
+static void league_reduce(long *total, long **partial, int num_workers, int count) {
+    for (int w = 0; w < num_workers; w++) {
+        for (int i = 0; i < count; i++) {
+            total[i] += partial[w][i];
+        }
+        free(partial[w]);
+    }
+    free(partial);
+}
+
+/**
+*@brief Simule le championnat sur le pool. Saison unique : les matchs d'une journee sont independants et repartis en tranches sur tous les workers, chaque worker tenant son propre classement partiel, et les classements partiels sont additionnes a la fin. Monte Carlo : les saisons sont reparties en lots, comme dans montecarlo_run.
+*@param l Le championnat.
+*@param pool Le pool de workers.
+*@return vide.
+*/
+void league_run(League *l, Pool *pool) {
+    int n = l->num_teams;
+
+    if (l->seasons == 0) {
+        int per_day = l->size / 2;
+        int num_slices = pool->num_workers * 4 < per_day ? pool->num_workers * 4 : per_day;
+        Slice *slices = (Slice*) malloc(num_slices * sizeof(Slice));
+        Standing **partial = (Standing**) malloc(pool->num_workers * sizeof(Standing*));
+        for (int w = 0; w < pool->num_workers; w++) {
+            partial[w] = (Standing*) calloc(n, sizeof(Standing));
+        }
+        //Une journee commence quand la precedente est terminee, comme dans un vrai calendrier
+        for (int day = 0; day < l->num_days; day++) {
+            for (int k = 0; k < num_slices; k++) {
+                slices[k].l = l;
+                slices[k].day = day;
+                slices[k].first = per_day * k / num_slices;
+                slices[k].last = per_day * (k + 1) / num_slices;
+                slices[k].partial = partial;
+                pool_submit(pool, league_slice, &slices[k]);
+            }
+            pool_wait(pool);
+        }
+        for (int w = 0; w < pool->num_workers; w++) {
+            for (int i = 0; i < n; i++) {
+                Standing *s = &partial[w][i];
+                l->table[i].played += s->played;
+                l->table[i].won += s->won;
+                l->table[i].drawn += s->drawn;
+                l->table[i].lost += s->lost;
+                l->table[i].goals_for += s->goals_for;
+                l->table[i].goals_against += s->goals_against;
+                l->table[i].points += s->points;
+            }
+            free(partial[w]);
+        }
+        free(partial);
+        free(slices);
+        return;
+    }
+
+    long num_chunks = (long) pool->num_workers * 8;
+    if (num_chunks > l->seasons) {
+        num_chunks = l->seasons;
+    }
+    Season *chunks = (Season*) malloc(num_chunks * sizeof(Season));
+    long **titles = (long**) malloc(pool->num_workers * sizeof(long*));
+    long **points = (long**) malloc(pool->num_workers * sizeof(long*));
+    long **ranks = (long**) malloc(pool->num_workers * sizeof(long*));
+    for (int w = 0; w < pool->num_workers; w++) {
+        titles[w] = (long*) calloc(n, sizeof(long));
+        points[w] = (long*) calloc(n, sizeof(long));
+        ranks[w] = (long*) calloc(n, sizeof(long));
+    }
+    for (long i = 0; i < num_chunks; i++) {
+        chunks[i].l = l;
+        chunks[i].first = l->seasons * i / num_chunks;
+        chunks[i].last = l->seasons * (i + 1) / num_chunks;
+        chunks[i].titles = titles;
+        chunks[i].points = points;
+        chunks[i].ranks = ranks;
+        pool_submit(pool, league_seasons, &chunks[i]);
+    }
+    pool_wait(pool);
+    league_reduce(l->titles, titles, pool->num_workers, n);
+    league_reduce(l->points, points, pool->num_workers, n);
+    league_reduce(l->ranks, ranks, pool->num_workers, n);
+    free(chunks);
+}
+
+/**
+ *@brief Championnat dont les equipes sont en cours de tri dans league_print
+*/
+static League *sorted;
+
+/**
+*@brief Compare deux equipes par nombre de titres decroissant, puis par total de points decroissant, puis par numero d'equipe.
+*@param a Pointeur sur le numero de la premiere equipe.
+*@param b Pointeur sur le numero de la seconde equipe.
+*@return Un entier negatif, nul ou positif, comme pour qsort.
+*/
+static int compare_titles(const void *a, const void *b) {
+    int ta = *(const int*) a;
+    int tb = *(const int*) b;
+    if (sorted->titles[ta] != sorted->titles[tb]) {
+        return sorted->titles[ta] < sorted->titles[tb] ? 1 : -1;
+    }
+    if (sorted->points[ta] != sorted->points[tb]) {
+        return sorted->points[ta] < sorted->points[tb] ? 1 : -1;
+    }
+    return ta - tb;
+}
+
+/**
+*@brief Affiche le classement final de la saison unique, ou, en Monte Carlo, la probabilite de titre, les points moyens et la place moyenne de chaque equipe.
+*@param l Le championnat termine.
+*@return vide.
+*/
+void league_print(League *l) {
+    if (l->seasons == 0) {
+        Rank *order = (Rank*) malloc(l->num_teams * sizeof(Rank));
+        league_rank(l->table, l->num_teams, order);
+        printf("%-4s %-25s %4s %4s %4s %4s %5s %5s %5s %4s\n", "Pos", "Equipe", "J", "G", "N", "P", "BP", "BC", "Diff", "Pts");
+        for (int r = 0; r < l->num_teams; r++) {
+            Standing *s = &l->table[order[r].team];
+            printf("%-4d %-25.*s %4d %4d %4d %4d %5d %5d %+5d %4d\n", r + 1, TEAM_MAX(order[r].team, 25), s->played, s->won,
+                   s->drawn, s->lost, s->goals_for, s->goals_against, s->goals_for - s->goals_against, s->points);
+        }
+        free(order);
+        return;
+    }
+    int *order = (int*) malloc(l->num_teams * sizeof(int));
+    for (int i = 0; i < l->num_teams; i++) {
+        order[i] = i;
+    }
+    sorted = l;
+    qsort(order, l->num_teams, sizeof(int), compare_titles);
+    printf("%-25s %9s %9s %9s\n", "Equipe", "Titre", "Points", "Place");
+    for (int i = 0; i < l->num_teams; i++) {
+        int t = order[i];
+        printf("%-25.*s %8.3f%% %9.2f %9.2f\n", TEAM_MAX(t, 25), 100.0 * l->titles[t] / l->seasons,
+               (double) l->points[t] / l->seasons, (double) l->ranks[t] / l->seasons);
+    }
+    free(order);
+}
+
+/**
+*@brief Libere le classement et les compteurs du championnat.
+*@param l Le championnat.
+*@return vide.
+*/
+void league_free(League *l) {
+    free(l->ranks);
+    free(l->points);
+    free(l->titles);
+    free(l->table);
+}
@@ -0,0 +1,45 @@
+#ifndef OS_LEAGUE_H
+#define OS_LEAGUE_H
+
+#include "fonctions.h"
+#include "pool.h"
+
+/**
+ *@brief Ligne du classement d'une equipe (3 points la victoire, 1 le nul)
+*/
+typedef struct Standing{
+    int played;
+    int won;
+    int drawn;
+    int lost;
+    int goals_for;
+    int goals_against;
+    int points;
+}Standing;
+
+/**
+ *@brief Championnat aller-retour : chaque equipe rencontre chaque autre equipe une fois a domicile (equipe 1) et une fois a l'exterieur.
+ * Le calendrier est genere par la methode du cercle sur size = num_teams arrondi au pair : chaque journee de la phase aller
+ * compte size/2 matchs independants, l'equipe fictive size - 1 (nombre impair d'equipes) etant exemptee ; la phase retour
+ * reprend les memes journees en inversant domicile et exterieur. Les matchs ne sont pas stockes, mais recalcules par journee et indice.
+ * Le match i de la journee d utilise le flux (seed, saison, d * (size/2) + i), le resultat ne depend donc pas du nombre de workers.
+*/
+typedef struct League{
+    int num_teams;      // nombre d'equipes
+    int size;           // num_teams arrondi au pair
+    int num_days;       // nombre de journees, 2 * (size - 1)
+    long seasons;       // nombre de saisons du Monte Carlo, 0 pour une saison unique detaillee
+    uint64_t seed;      // graine globale
+    Standing *table;    // classement fusionne de la saison unique
+    long *titles;       // Monte Carlo : nombre de titres de chaque equipe
+    long *points;       // Monte Carlo : total des points de chaque equipe
+    long *ranks;        // Monte Carlo : total des places finales de chaque equipe (1 pour le premier)
+}League;
+
+void league_init(League *l, int num_teams, long seasons, uint64_t seed);
+void league_fixture(League *l, int day, int i, int *home, int *away);
+void league_run(League *l, Pool *pool);
+void league_print(League *l);
+void league_free(League *l);
+
+#endif
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "results.h"
+/**
+ * @file lecteur.c
+ * @brief Lecteur des fichiers de resultats binaires (--format binary)
+ * Sans option, le fichier est reconverti dans le format texte de matchs.txt par un tri externe de memoire bornee ;
+ * avec --stats, des statistiques agregees sont calculees en un seul passage, sans charger les enregistrements en memoire.
+*/
+
+/**
+ *@brief Enregistrements tries en memoire a la fois (64 Mo) : au-dela, print_text trie par sequences et les fusionne
+*/
+#define RUN_RECORDS (1 << 21)
+
+/**
+ *@brief Enregistrements lus a la fois dans chaque sequence pendant la fusion (128 Ko)
+*/
+#define MERGE_RECORDS 4096
+
+/**
+ *@brief Fichier de resultats projete en memoire
+*/
+typedef struct Results{
+    const char *data;
+    size_t size;
+    const ResultHeader *header;
+    const char **names;     // nom de chaque equipe, dans la table de l'en-tete
+    uint32_t *lengths;
+    const MatchRecord *records;
+    size_t num_records;
+}Results;
+
+/**
+ *@brief Sequence triee ecrite dans un fichier temporaire, relue par blocs pendant la fusion
+*/
+typedef struct Run{
+    FILE *fp;
+    MatchRecord *buf;   // bloc en cours de lecture
+    size_t count;       // enregistrements dans le bloc
+    size_t pos;         // prochain enregistrement du bloc
+}Run;
+
+/**
+ *@brief Ecriture au format texte des enregistrements tries, un par un
+*/
+typedef struct Printer{
+    Results *r;
+    FILE *out;
+    int several;            // 1 si le fichier contient plusieurs tournois
+    int started;
+    uint64_t tournament;    // tournoi du dernier enregistrement ecrit
+    int played;             // numero du dernier match ecrit dans ce tournoi
+}Printer;
+
+/**
+*@brief Projette le fichier en memoire et verifie son en-tete et sa table des equipes.
+*@param r Le fichier a initialiser.
+*@param path Le chemin du fichier.
+*@return vide, le programme s'arrete si le fichier n'est pas un fichier de resultats valide.
+*/
+static void results_load(Results *r, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        printf("Erreur lors de l'ouverture du fichier %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    r->size = st.st_size;
+    r->data = r->size > 0 ? (const char*) mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (r->data == MAP_FAILED || r->size < sizeof(ResultHeader)) {
+        printf("Fichier %s invalide.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    r->header = (const ResultHeader*) r->data;
+    if (memcmp(r->header->magic, RESULTS_MAGIC, 4) != 0 || r->header->version != RESULTS_VERSION
+        || r->header->record_size != sizeof(MatchRecord) || r->header->records_offset > r->size) {
+        printf("Fichier %s invalide ou de version non supportee.\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    //Table des equipes : longueur puis nom, pour chaque equipe
+    r->names = (const char**) malloc(r->header->num_teams * sizeof(char*));
+    r->lengths = (uint32_t*) malloc(r->header->num_teams * sizeof(uint32_t));
+    size_t pos = sizeof(ResultHeader);
+    for (uint32_t i = 0; i < r->header->num_teams; i++) {
+        if (pos + sizeof(uint32_t) > r->header->records_offset) {
+            printf("Table des equipes tronquee.\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(&r->lengths[i], r->data + pos, sizeof(uint32_t));
+        r->names[i] = r->data + pos + sizeof(uint32_t);
+        pos += sizeof(uint32_t) + r->lengths[i];
+        if (pos > r->header->records_offset) {
+            printf("Table des equipes tronquee.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    r->records = (const MatchRecord*) (r->data + r->header->records_offset);
+    r->num_records = (r->size - r->header->records_offset) / sizeof(MatchRecord);
+    for (size_t i = 0; i < r->num_records; i++) {
+        if (r->records[i].team1 >= r->header->num_teams || r->records[i].team2 >= r->header->num_teams) {
+            printf("Enregistrement %zu invalide.\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+*@brief Compare deux enregistrements par tournoi, puis par indice de match.
+*@param a Pointeur sur le premier enregistrement.
+*@param b Pointeur sur le second enregistrement.
+*@return Un entier negatif, nul ou positif, comme pour qsort.
+*/
+static int compare_records(const void *a, const void *b) {
+    const MatchRecord *ra = (const MatchRecord*) a;
+    const MatchRecord *rb = (const MatchRecord*) b;
+    if (ra->tournament != rb->tournament) {
+        return ra->tournament < rb->tournament ? -1 : 1;
+    }
+    return ra->match < rb->match ? -1 : ra->match > rb->match;
+}
+
+/**
+*@brief Ecrit un match au format de matchs.txt, precede de la ligne "Tournoi n" au premier match de chaque tournoi si le fichier en contient plusieurs.
+*@param p L'ecriture en cours.
+*@param m Le match, qui suit le precedent dans l'ordre de compare_records.
+*@return vide.
+*/
+static void print_record(Printer *p, const MatchRecord *m) {
+    if (!p->started || m->tournament != p->tournament) {
+        p->started = 1;
+        p->tournament = m->tournament;
+        p->played = 0;
+        if (p->several) {
+            fprintf(p->out, "Tournoi %llu\n", (unsigned long long) m->tournament);
+        }
+    }
+    p->played++;
+    fprintf(p->out, "Match %d : %.*s [%d] : [%d] %.*s | Tour %d\n", p->played, (int) p->r->lengths[m->team1], p->r->names[m->team1],
+            m->score1, m->score2, (int) p->r->lengths[m->team2], p->r->names[m->team2], m->tour);
+}
+
+/**
+*@brief Lit le bloc suivant d'une sequence.
+*@param run La sequence.
+*@return Le nombre d'enregistrements lus, 0 a la fin de la sequence.
+*/
+static size_t run_fill(Run *run) {
+    run->count = fread(run->buf, sizeof(MatchRecord), MERGE_RECORDS, run->fp);
+    run->pos = 0;
+    return run->count;
+}
+
+/**
+*@brief Fait descendre une sequence dans le tas de fusion, ordonne par l'enregistrement courant de chaque sequence.
+*@param runs Les sequences.
+*@param heap Le tas, des indices de sequences.
+*@param size Le nombre de sequences dans le tas.
+*@param i La position a retablir.
+*@return vide.
+*/
+static void heap_down(Run *runs, int *heap, int size, int i) {
+    for (;;) {
+        int least = i;
+        for (int c = 2 * i + 1; c <= 2 * i + 2 && c < size; c++) {
+            if (compare_records(&runs[heap[c]].buf[runs[heap[c]].pos], &runs[heap[least]].buf[runs[heap[least]].pos]) < 0) {
+                least = c;
+            }
+        }
+        if (least == i) {
+            return;
+        }
+        int tmp = heap[i];
+        heap[i] = heap[least];
+        heap[least] = tmp;
+        i = least;
+    }
+}
+
+/**
+*@brief Ecrit les matchs au format de matchs.txt, dans l'ordre du tableau de chaque tournoi. Quand le fichier contient plusieurs tournois, chacun est precede d'une ligne "Tournoi n".
+* Les enregistrements sont dans l'ordre de fin des matchs, melanges entre workers : ils sont tries par sequences de RUN_RECORDS,
+* ecrites dans des fichiers temporaires, puis fusionnes. La memoire reste bornee (RUN_RECORDS enregistrements pour le tri, puis
+* MERGE_RECORDS par sequence pour la fusion) quel que soit le nombre de matchs ; un petit fichier est trie en une seule fois.
+*@param r Le fichier de resultats.
+*@param out La destination.
+*@return vide.
+*/
+static void print_text(Results *r, FILE *out) {
+    Printer p = {r, out, 0, 0, 0, 0};
+    size_t chunk = r->num_records < RUN_RECORDS ? r->num_records : RUN_RECORDS;
+    MatchRecord *buf = (MatchRecord*) malloc((chunk > 0 ? chunk : 1) * sizeof(MatchRecord));
+
+    for (size_t i = 1; i < r->num_records && !p.several; i++) {
+        p.several = r->records[i].tournament != r->records[0].tournament;
+    }
+    if (r->num_records <= RUN_RECORDS) {
+        memcpy(buf, r->records, r->num_records * sizeof(MatchRecord));
+        qsort(buf, r->num_records, sizeof(MatchRecord), compare_records);
+        for (size_t i = 0; i < r->num_records; i++) {
+            print_record(&p, &buf[i]);
+        }
+        free(buf);
+        return;
+    }
+
+    //Sequences triees, chacune dans un fichier temporaire supprime a sa fermeture
+    int num_runs = (int) ((r->num_records + RUN_RECORDS - 1) / RUN_RECORDS);
+    Run *runs = (Run*) calloc(num_runs, sizeof(Run));
+    for (int k = 0; k < num_runs; k++) {
+        size_t first = (size_t) k * RUN_RECORDS;
+        size_t count = r->num_records - first < RUN_RECORDS ? r->num_records - first : RUN_RECORDS;
+        memcpy(buf, &r->records[first], count * sizeof(MatchRecord));
+        qsort(buf, count, sizeof(MatchRecord), compare_records);
+        runs[k].fp = tmpfile();
+        if (runs[k].fp == NULL || fwrite(buf, sizeof(MatchRecord), count, runs[k].fp) != count || fflush(runs[k].fp) != 0) {
+            printf("Erreur lors de l'ecriture d'un fichier temporaire.\n");
+            exit(EXIT_FAILURE);
+        }
+        rewind(runs[k].fp);
+        //Les pages deja triees ne servent plus : le noyau peut les liberer
+        madvise((void*) ((uintptr_t) &r->records[first] & ~(uintptr_t) 4095), count * sizeof(MatchRecord), MADV_DONTNEED);
+    }
+    free(buf);
+
+    //Fusion : le tas donne la sequence dont l'enregistrement courant est le plus petit
+    int *heap = (int*) malloc(num_runs * sizeof(int));
+    int size = 0;
+    for (int k = 0; k < num_runs; k++) {
+        runs[k].buf = (MatchRecord*) malloc(MERGE_RECORDS * sizeof(MatchRecord));
+        run_fill(&runs[k]);
+        heap[size++] = k;
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) {
+        heap_down(runs, heap, size, i);
+    }
+    while (size > 0) {
+        Run *run = &runs[heap[0]];
+        print_record(&p, &run->buf[run->pos]);
+        if (++run->pos == run->count && run_fill(run) == 0) {
+            heap[0] = heap[--size];
+        }
+        heap_down(runs, heap, size, 0);
+    }
+    for (int k = 0; k < num_runs; k++) {
+        fclose(runs[k].fp);
+        free(runs[k].buf);
+    }
+    free(heap);
+    free(runs);
+}
+
+/**
+*@brief Affiche des statistiques agregees : nombre de tournois et de matchs, buts par match, puis pour chaque equipe les matchs joues, les victoires et les titres (victoires en finale).
+*@param r Le fichier de resultats.
+*@return vide.
+*/
+static void print_stats(Results *r) {
+    uint32_t n = r->header->num_teams;
+    uint32_t size = 1;
+    while (size < n) {
+        size *= 2;
+    }
+    uint32_t final = size - 2; // indice de la finale dans le tableau
+    long *played = (long*) calloc(n, sizeof(long));
+    long *wins = (long*) calloc(n, sizeof(long));
+    long *titles = (long*) calloc(n, sizeof(long));
+    long tournaments = 0;
+    unsigned long long goals = 0;
+
+    for (size_t i = 0; i < r->num_records; i++) {
+        const MatchRecord *m = &r->records[i];
+        uint32_t winner = m->score1 > m->score2 ? m->team1 : m->team2;
+        played[m->team1]++;
+        played[m->team2]++;
+        wins[winner]++;
+        goals += m->score1 + m->score2;
+        if (m->match == final) {
+            titles[winner]++;
+            tournaments++;
+        }
+    }
+
+    printf("Graine : %llu | Duree : %u minutes | Equipes : %u\n", (unsigned long long) r->header->seed, r->header->match_duration, n);
+    printf("Tournois termines : %ld | Matchs : %zu | Buts par match (tirs au but compris) : %.3f\n", tournaments, r->num_records,
+           r->num_records > 0 ? (double) goals / r->num_records : 0.0);
+    printf("%-25s %10s %10s %10s\n", "Equipe", "Matchs", "Victoires", "Titres");
+    for (uint32_t i = 0; i < n; i++) {
+        printf("%-25.*s %10ld %10ld %10ld\n", r->lengths[i] < 25 ? (int) r->lengths[i] : 25, r->names[i], played[i], wins[i], titles[i]);
+    }
+    free(titles);
+    free(wins);
+    free(played);
+}
+
+/**
+ *@brief Fonction principale du lecteur
+ *@param argc Nombre d'arguments passés au programme
+ *@param argv [--stats] fichier.bin [sortie.txt]
+ *@return 0, ou EXIT_FAILURE en cas d'erreur
+*/
+int main(int argc, char *argv[]) {
+    int stats = 0;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--stats") == 0) {
+        stats = 1;
+        arg++;
+    }
+    if (arg >= argc) {
+        printf("Usage : %s [--stats] fichier.bin [sortie.txt]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    Results r;
+    results_load(&r, argv[arg]);
+    if (stats) {
+        print_stats(&r);
+    } else {
+        FILE *out = stdout;
+        if (arg + 1 < argc && (out = fopen(argv[arg + 1], "w")) == NULL) {
+            printf("Erreur lors de l'ouverture du fichier %s.\n", argv[arg + 1]);
+            exit(EXIT_FAILURE);
+        }
+        print_text(&r, out);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+    munmap((void*) r.data, r.size);
+    free(r.lengths);
+    free(r.names);
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include "live.h"
+#include "bracket.h"
+#include "eventlog.h"
+
+/**
+ *@brief Attente maximale du thread de l'horloge, pour lire les commandes et voir la demande d'arret
+*/
+#define LIVE_POLL_NS 100000000L
+
+/**
+ *@brief Horloge active, NULL hors mode temps reel
+*/
+LiveClock *live_clock = NULL;
+
+/**
+*@brief Horloge monotone.
+*@return Le temps courant en nanosecondes.
+*/
+static uint64_t live_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+*@brief Initialise une roue vide au tick 0.
+*@param w La roue.
+*@return vide.
+*/
+void wheel_init(TimerWheel *w) {
+    memset(w, 0, sizeof(TimerWheel));
+}
+
+/**
+*@brief Range un timer dans la case du niveau le plus bas qui contient son echeance.
+*@param w La roue.
+*@param t Le timer, dont l'echeance est posterieure au tick courant.
+*@return vide.
+*/
+static void wheel_insert(TimerWheel *w, Timer *t) {
+    uint64_t max = (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    if (t->expires - w->tick > max) { // au-dela de la roue : recale sur la derniere echeance representable
+        t->expires = w->tick + max;
+    }
+    uint64_t delta = t->expires - w->tick;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >> (WHEEL_BITS * (level + 1)) != 0) {
+        level++;
+    }
+    int slot = (t->expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    t->next = w->slots[level][slot];
+    w->slots[level][slot] = t;
+}
+
+/**
+*@brief Arme un timer ; une echeance deja passee est reportee au prochain tick.
+*@param w La roue.
+*@param t Le timer.
+*@return vide.
+*/
+void wheel_add(TimerWheel *w, Timer *t) {
+    if (t->expires <= w->tick) {
+        t->expires = w->tick + 1;
+    }
+    wheel_insert(w, t);
+}
+
+/**
+*@brief Avance la roue d'un tick : quand un niveau a fait un tour, la case suivante du niveau superieur est redescendue, puis la case courante du niveau 0 est videe.
+*@param w La roue.
+*@return La liste chainee des timers qui expirent a ce tick.
+*/
+Timer *wheel_advance(TimerWheel *w) {
+    w->tick++;
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if ((w->tick & ((1ull << (WHEEL_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        int slot = (w->tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+        Timer *t = w->slots[level][slot];
+        w->slots[level][slot] = NULL;
+        while (t != NULL) {
+            Timer *next = t->next;
+            wheel_insert(w, t);
+            t = next;
+        }
+    }
+    int slot = w->tick & (WHEEL_SLOTS - 1);
+    Timer *expired = w->slots[0][slot];
+    w->slots[0][slot] = NULL;
+    return expired;
+}
+
+/**
+*@brief Arme un timer ticks ticks apres le tick courant.
+*@param c L'horloge.
+*@param t Le timer, dont fn et arg sont deja remplis.
+*@param ticks Le delai.
+*@return vide.
+*/
+static void live_add(LiveClock *c, Timer *t, int ticks) {
+    pthread_mutex_lock(&c->lock);
+    t->expires = c->wheel.tick + ticks;
+    wheel_add(&c->wheel, t);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/**
+*@brief Applique une commande lue sur l'entree standard.
+*@param c L'horloge.
+*@param cmd Le caractere de la commande.
+*@param deadline L'echeance du prochain tick, recalee si besoin.
+*@return vide.
+*/
+static void live_command(LiveClock *c, char cmd, uint64_t *deadline) {
+    pthread_mutex_lock(&c->lock);
+    switch (cmd) {
+        case 'p':
+            c->paused = !c->paused;
+            *deadline = live_now() + c->scale_ns;
+            fprintf(stderr, c->paused ? "Horloge : pause\n" : "Horloge : reprise\n");
+            break;
+        case '+':
+            c->scale_ns /= 2;
+            fprintf(stderr, "Horloge : 1 minute = %.3f ms\n", c->scale_ns / 1e6);
+            break;
+        case '-':
+            c->scale_ns = c->scale_ns > 0 ? c->scale_ns * 2 : 1000000;
+            fprintf(stderr, "Horloge : 1 minute = %.3f ms\n", c->scale_ns / 1e6);
+            break;
+        case 'f':
+            atomic_store(&c->whistle, c->wheel.tick + 1);
+            *deadline = live_now();
+            fprintf(stderr, "Horloge : coup de sifflet final\n");
+            break;
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+/**
+*@brief Boucle du thread de l'horloge : a chaque echeance, avance la roue d'un tick et lance les timers expires, chacun sur son worker ; entre deux ticks, attend les commandes sur l'entree standard (select), par tranches d'au plus LIVE_POLL_NS.
+*@param arg L'horloge.
+*@return NULL
+*/
+static void *live_thread(void *arg) {
+    LiveClock *c = (LiveClock*) arg;
+    uint64_t deadline = live_now() + c->scale_ns;
+    int input = c->controls;
+
+    while (!atomic_load(&c->stop)) {
+        uint64_t now = live_now();
+        if (!c->paused && now >= deadline) {
+            pthread_mutex_lock(&c->lock);
+            Timer *t = wheel_advance(&c->wheel);
+            deadline += c->scale_ns;
+            pthread_mutex_unlock(&c->lock);
+            if (deadline < now) { // en retard : pas de rafale de ticks pour rattraper
+                deadline = now;
+            }
+            while (t != NULL) {
+                Timer *next = t->next; // la tache peut rearmer le timer aussitot
+                if (c->pool != NULL) {
+                    pool_submit_to(c->pool, t->worker, t->fn, t->arg);
+                } else {
+                    t->fn(t->arg);
+                }
+                t = next;
+            }
+            continue;
+        }
+        uint64_t wait = c->paused || deadline - now > LIVE_POLL_NS ? LIVE_POLL_NS : deadline - now;
+        struct timeval timeout = {0, (long) (wait / 1000)};
+        fd_set set;
+        FD_ZERO(&set);
+        if (input) {
+            FD_SET(STDIN_FILENO, &set);
+        }
+        if (select(input ? STDIN_FILENO + 1 : 0, &set, NULL, NULL, &timeout) == 1) {
+            char buf[64];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0) {
+                input = 0; // fin de l'entree standard : plus de commandes
+            }
+            for (ssize_t i = 0; i < n; i++) {
+                live_command(c, buf[i], &deadline);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+*@brief Demarre l'horloge partagee et la rend active.
+*@param c L'horloge.
+*@param scale_ms La duree reelle d'une minute simulee, en millisecondes.
+*@param pool Le pool qui execute les minutes des matchs, NULL pour lancer les timers dans le thread de l'horloge.
+*@param num_matchs Le nombre de matchs du tableau qui peuvent etre joues en temps reel (live_match).
+*@param controls 1 pour lire les commandes globales sur l'entree standard.
+*@return vide.
+*/
+void live_start(LiveClock *c, long scale_ms, Pool *pool, int num_matchs, int controls) {
+    wheel_init(&c->wheel);
+    pthread_mutex_init(&c->lock, NULL);
+    c->scale_ns = scale_ms * 1000000L;
+    c->paused = 0;
+    c->controls = controls;
+    atomic_init(&c->whistle, 0);
+    c->pool = pool;
+    c->matchs = (LiveMatch*) calloc(num_matchs, sizeof(LiveMatch));
+    atomic_init(&c->stop, 0);
+    if (controls) {
+        fprintf(stderr, "Commandes : p (pause/reprise), + (plus vite), - (moins vite), f (coup de sifflet final)\n");
+    }
+    pthread_create(&c->thread, NULL, live_thread, c);
+    live_clock = c;
+}
+
+/**
+*@brief Arrete l'horloge. Aucun timer ne doit plus etre arme.
+*@param c L'horloge.
+*@return vide.
+*/
+void live_stop(LiveClock *c) {
+    atomic_store(&c->stop, 1);
+    pthread_join(c->thread, NULL);
+    live_clock = NULL;
+    free(c->matchs);
+    pthread_mutex_destroy(&c->lock);
+}
+
+/**
+*@brief Tache d'une minute d'un match en temps reel : joue la minute suivante avec le moteur de reference (play_minute, --live refuse les autres moteurs) puis rearme le timer du match pour le tick suivant. Apres le coup de sifflet final global, les minutes restantes sont jouees d'un coup. A la fin du temps reglementaire, le match se termine comme simulate_match.
+*@param arg Le LiveMatch.
+*@return NULL
+*/
+static void *live_minute(void *arg) {
+    LiveMatch *lm = (LiveMatch*) arg;
+    Match match = lm->match;
+    int finish = lm->started < atomic_load(&live_clock->whistle);
+
+    do {
+        if (lm->minute < match_duration) {
+            lm->minute++;
+            play_minute(match, lm->minute, 1);
+        }
+    } while (finish && lm->minute < match_duration);
+
+    if (lm->minute < match_duration) {
+        live_add(live_clock, &lm->timer, 1);
+        return NULL;
+    }
+    penalty_shootout(match, 1);
+    report_match(match);
+    STATS_ROUND(match->tour, lm->start);
+    log_event(EV_FIN, match, 0);
+    return NULL;
+}
+
+/**
+*@brief Coup d'envoi d'un match en temps reel, sur le worker du match : le debut est publie puis le timer est arme pour la premiere minute.
+*@param arg Le LiveMatch.
+*@return NULL
+*/
+static void *live_kickoff(void *arg) {
+    LiveMatch *lm = (LiveMatch*) arg;
+
+    log_event(EV_DEBUT, lm->match, 0);
+    pthread_mutex_lock(&live_clock->lock);
+    lm->started = live_clock->wheel.tick;
+    lm->timer.expires = lm->started + 1;
+    wheel_add(&live_clock->wheel, &lm->timer);
+    pthread_mutex_unlock(&live_clock->lock);
+    return NULL;
+}
+
+/**
+*@brief Remplace simulate_match en mode temps reel (Bracket.play) : le match avance ensuite d'une minute a chaque tick de l'horloge partagee, sans thread endormi. Toutes ses taches (coup d'envoi et minutes) sont executees par le meme worker, choisi d'apres sa case du tableau : ses evenements passent donc par un seul tampon du journal et restent dans l'ordre.
+*@param arg Le match, qui doit appartenir a bracket.matchs.
+*@return NULL
+*/
+void *live_match(void *arg) {
+    Match match = (Match) arg;
+    int id = match - bracket.matchs;
+    LiveMatch *lm = &live_clock->matchs[id];
+
+    lm->match = match;
+    lm->minute = 0;
+#ifdef WITH_STATS
+    lm->start = stats_enabled ? stats_now() : 0;
+#endif
+    lm->timer.fn = live_minute;
+    lm->timer.arg = lm;
+    lm->timer.worker = id;
+    if (live_clock->pool != NULL) {
+        pool_submit_to(live_clock->pool, id, live_kickoff, lm);
+    } else {
+        live_kickoff(lm);
+    }
+    return NULL;
+}
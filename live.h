@@ -0,0 +1,72 @@
+#ifndef OS_LIVE_H
+#define OS_LIVE_H
+
+#include "fonctions.h"
+#include "pool.h"
+#include <stdatomic.h>
+
+/**
+ *@brief Roue de temporisation hierarchique : WHEEL_LEVELS niveaux de WHEEL_SLOTS cases. Une case du niveau l
+ * couvre 64^l ticks ; un timer est range au niveau le plus bas qui contient son echeance, puis redescend
+ * d'un niveau (cascade) quand la roue du dessous a fait un tour. Ajout et expiration sont en O(1).
+*/
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+/**
+ *@brief Timer intrusif : la tache fn(arg) est lancee au tick expires, toujours sur le meme worker du pool
+*/
+typedef struct Timer{
+    uint64_t expires;
+    struct Timer *next;
+    void *(*fn)(void *);
+    void *arg;
+    int worker;         // worker qui execute la tache (pool_submit_to)
+}Timer;
+
+typedef struct TimerWheel{
+    uint64_t tick;                              // tick courant, deja traite
+    Timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+}TimerWheel;
+
+/**
+ *@brief Etat d'un match joue en temps reel, une minute par tick
+*/
+typedef struct LiveMatch{
+    Timer timer;
+    Match match;
+    int minute;         // derniere minute jouee
+    uint64_t started;   // tick du coup d'envoi
+    uint64_t start;     // debut du match pour les statistiques (--stats)
+}LiveMatch;
+
+/**
+ *@brief Horloge partagee du mode temps reel : un seul thread avance la roue d'un tick par minute simulee
+ * et lance les timers expires sur le pool. Il lit aussi les commandes globales sur l'entree standard :
+ * p (pause / reprise), + (deux fois plus vite), - (deux fois plus lent), f (coup de sifflet final).
+*/
+typedef struct LiveClock{
+    TimerWheel wheel;
+    pthread_mutex_t lock;   // protege la roue et les reglages
+    long scale_ns;          // duree reelle d'un tick, 0 pour avancer sans attendre
+    int paused;
+    int controls;           // 1 si les commandes sont lues sur l'entree standard
+    _Atomic uint64_t whistle; // les matchs commences avant ce tick terminent leur temps reglementaire d'un coup
+    Pool *pool;             // execute les timers expires, NULL pour les lancer dans le thread de l'horloge
+    LiveMatch *matchs;      // etat de chaque match du tableau du tournoi
+    atomic_int stop;
+    pthread_t thread;
+}LiveClock;
+
+extern LiveClock *live_clock;
+
+void wheel_init(TimerWheel *w);
+void wheel_add(TimerWheel *w, Timer *t);
+Timer *wheel_advance(TimerWheel *w);
+
+void live_start(LiveClock *c, long scale_ms, Pool *pool, int num_matchs, int controls);
+void live_stop(LiveClock *c);
+void *live_match(void *arg);
+
+#endif
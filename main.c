@@ -1,4 +1,18 @@
 #include "fonctions.h"
+#include "bracket.h"
+#include "montecarlo.h"
+#include "batch.h"
+#include "eventlog.h"
+#include "results.h"
+#include "live.h"
+#include "table.h"
+#include "analytic.h"
+#include "league.h"
+#include "server.h"
+#include "shard.h"
+#include "checkpoint.h"
+#include "manual.h"
+#include <getopt.h>
 /**
  * @file main.c
  * @brief Programme principal pour la simulation du tournoi
@@ -23,9 +37,9 @@ int match_duration = DURATION;
 int num_teams;
 
 /**
- *@brief Tableau des noms des équipes, indicé par les numeros des equipes
+ *@brief Table des équipes (arena de noms et index), indicée par les numeros des equipes
 */
-char **team_names;
+TeamTable teams;
 
 /**
  *@brief Tableau des équipes restantes, indicé par les numeros des equipes, contient (-1: si l'equipe est eliminé | 0: si l'equipe est entrain de jouer | n: si l'equipe est au tour n, prete a jouer)
@@ -37,25 +51,185 @@ int * teams_remaining;
 */
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ *@brief Tableau du tournoi : matchs ranges tour par tour et file des matchs prets a etre lances
+*/
+Bracket bracket;
+
+/**
+ *@brief Options de la ligne de commande
+*/
+Options options;
+
+/**
+ *@brief Affiche l'utilisation du programme et quitte en erreur
+ *@param prog Nom du programme (argv[0])
+*/
+static void usage(char *prog)
+{
+    printf("Usage : %s [--threads N] [--seed S] [--runs N] [--engine minute|skip|batch|table] [--quiet[=N]] [--log FICHIER] [--format text|binary] [--output FICHIER] [--stats[=FICHIER]] [--live[=MS]] [--analytic] [--league] [--serve SOCKET] [--shards K] [--checkpoint FICHIER [--checkpoint-interval S] [--resume]] [fichier_equipes]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
 
 /**
  *@brief Fonction principale
  *Cette fonction lit le nom des équipes depuis un fichier, initialise les tableaux et les structures nécessaires pour la simulation, et lance la simulation du tournoi en mode concurrent ou manuel.
  *@param argc Nombre d'arguments passés au programme
  *@param argv Tableau de chaînes de caractères contenant les arguments passés au programme
- *@return Toujours 1
+ *@return EXIT_SUCCESS, les erreurs arretent le programme avec EXIT_FAILURE
 */
 int main(int argc, char *argv[])
 {
-    char * filename;
-    if (argc != 2) {
-        filename = FILENAME;
-    }else {
-        filename = argv[1];
+    char * filename = FILENAME;
+    static struct option long_options[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 's'},
+        {"runs", required_argument, NULL, 'r'},
+        {"engine", required_argument, NULL, 'e'},
+        {"quiet", optional_argument, NULL, 'q'},
+        {"log", required_argument, NULL, 'l'},
+        {"format", required_argument, NULL, 'f'},
+        {"output", required_argument, NULL, 'o'},
+        {"stats", optional_argument, NULL, 'S'},
+        {"live", optional_argument, NULL, 'L'},
+        {"analytic", no_argument, NULL, 'a'},
+        {"league", no_argument, NULL, 'g'},
+        {"serve", required_argument, NULL, 'u'},
+        {"shards", required_argument, NULL, 'k'},
+        {"checkpoint", required_argument, NULL, 'c'},
+        {"checkpoint-interval", required_argument, NULL, 'I'},
+        {"resume", no_argument, NULL, 'R'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    int format_set = 0; // --format donne explicitement
+
+    options.threads = pool_default_threads();
+    options.seed = (uint64_t) time(NULL);
+    options.interval = CHECKPOINT_INTERVAL;
+    while ((opt = getopt_long(argc, argv, "t:s:r:e:q::l:f:o:S::L::agu:k:c:I:R", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                options.threads = atoi(optarg);
+                if (options.threads <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 's':
+                options.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'r':
+                options.runs = atol(optarg);
+                if (options.runs <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "minute") == 0) {
+                    options.engine = ENGINE_MINUTE;
+                } else if (strcmp(optarg, "skip") == 0) {
+                    options.engine = ENGINE_SKIP;
+                } else if (strcmp(optarg, "batch") == 0) {
+                    options.engine = ENGINE_BATCH;
+                } else if (strcmp(optarg, "table") == 0) {
+                    options.engine = ENGINE_TABLE;
+                } else {
+                    usage(argv[0]);
+                }
+                break;
+            case 'q':
+                options.quiet = optarg != NULL ? atoi(optarg) : 1;
+                break;
+            case 'l':
+                options.log = optarg;
+                break;
+            case 'f':
+                format_set = 1;
+                if (strcmp(optarg, "text") == 0) {
+                    options.format = FORMAT_TEXT;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    options.format = FORMAT_BINARY;
+                } else {
+                    usage(argv[0]);
+                }
+                break;
+            case 'o':
+                options.output = optarg;
+                break;
+            case 'L':
+                options.live = optarg != NULL ? atol(optarg) : 10;
+                if (options.live <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'a':
+                options.analytic = 1;
+                break;
+            case 'g':
+                options.league = 1;
+                break;
+            case 'u':
+                options.serve = optarg;
+                break;
+            case 'k':
+                options.shards = atoi(optarg);
+                if (options.shards <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'c':
+                options.checkpoint = optarg;
+                break;
+            case 'I':
+                options.interval = atoi(optarg);
+                if (options.interval <= 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'R':
+                options.resume = 1;
+                break;
+            case 'S':
+                if (stats_enable(optarg) < 0) {
+                    printf("Statistiques non disponibles : utiliser la version de developpement (make, STATS=1), pas release.\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        filename = argv[optind];
+    }
+    //Une reprise ne se fait qu'a partir d'un point de reprise d'un Monte Carlo
+    if (options.resume && options.checkpoint == NULL) {
+        usage(argv[0]);
+    }
+    //Le temps reel avance chaque match minute par minute : seul le moteur de reference le permet
+    if (options.live > 0 && options.engine != ENGINE_MINUTE) {
+        printf("--live joue les matchs minute par minute : --engine skip, batch et table ne sont pas disponibles en temps reel.\n");
+        exit(EXIT_FAILURE);
     }
+    //Le championnat affiche son classement sans ecrire de fichier de resultats
+    if (options.league && (format_set || options.output != NULL)) {
+        printf("--league affiche le classement sur la sortie standard : --format et --output ne sont pas disponibles en championnat.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options.output == NULL) {
+        options.output = options.format == FORMAT_BINARY ? "matchs.bin" : "matchs.txt";
+    }
+    batch_detect();
 
     //Creation d'une liste randomise avec les equipes
-    read_team_names(filename, &num_teams, &team_names);
+    read_team_names(filename, &num_teams, &teams);
+
+    //Moteur par tables : distributions des resultats precalculees une fois pour toutes
+    if (options.engine == ENGINE_TABLE && table_build(&outcomes) < 0) {
+        printf("Tables de resultats trop grandes pour cette duree de match, moteur minute utilise.\n");
+        options.engine = ENGINE_MINUTE;
+    }
 
     //Allocation du tableau teams_remaining
     teams_remaining = (int *)malloc(num_teams*sizeof(int));
@@ -66,86 +240,207 @@ int main(int argc, char *argv[])
         teams_remaining[i] = 1;
     }
 
-    int num_matchs_total = num_teams-1;
-    Match matchs[num_matchs_total];
-    int num_match = 0;
-    int team1 = 0;
-    int team2 = 0;
-    int tour = 1;
+    //Mode serveur : equipes, tables et pool prepares une seule fois pour toutes les requetes
+    if (options.serve != NULL) {
+        Server server;
+        Pool pool;
+        options.quiet = 2; // aucun evenement de match n'est affiche par le serveur
+        pool_init(&pool, options.threads);
+        if (server_open(&server, options.serve, &pool) < 0) {
+            printf("Erreur lors de la creation de la socket %s.\n", options.serve);
+            exit(EXIT_FAILURE);
+        }
+        printf("Serveur en ecoute sur %s (%d equipes, %d workers)\n", options.serve, num_teams, options.threads);
+        fflush(stdout);
+        STATS_START(run);
+        server_run(&server);
+        STATS_PHASE(STATS_RUN, run);
+        server_close(&server);
+        pool_destroy(&pool);
+        if (options.engine == ENGINE_TABLE) {
+            table_free(&outcomes);
+        }
+        free_memory();
+        stats_dump();
+        return EXIT_SUCCESS;
+    }
+
+    //Mode championnat : saison unique detaillee, ou Monte Carlo sur --runs saisons, sans question interactive
+    //Le fichier de resultats decrit un tableau a elimination directe, il n'est pas ecrit en championnat
+    if (options.league) {
+        League league;
+        Pool pool;
+        EventLog log;
+        FILE *out = stdout;
+        if (options.log != NULL && (out = fopen(options.log, "w")) == NULL) {
+            printf("Erreur lors de l'ouverture du fichier %s.\n", options.log);
+            exit(EXIT_FAILURE);
+        }
+        league_init(&league, num_teams, options.runs, options.seed);
+        STATS_START(spawn);
+        eventlog_start(&log, options.threads, out);
+        pool_init(&pool, options.threads);
+        STATS_PHASE(STATS_SPAWN, spawn);
+        STATS_START(run);
+        league_run(&league, &pool);
+        STATS_PHASE(STATS_RUN, run);
+        STATS_START(join);
+        pool_destroy(&pool);
+        eventlog_stop(&log);
+        STATS_PHASE(STATS_JOIN, join);
+        if (out != stdout) {
+            fclose(out);
+        }
+        league_print(&league);
+        league_free(&league);
+        if (options.engine == ENGINE_TABLE) {
+            table_free(&outcomes);
+        }
+        free_memory();
+        stats_dump();
+        return EXIT_SUCCESS;
+    }
+
+    //Format binaire : les matchs sont enregistres au fil de leur fin, par les workers eux-memes
+    //Les tampons du fichier appartiennent a un seul processus : pas de fichier binaire avec --shards
+    if ((options.shards > 0 || options.checkpoint != NULL) && options.runs > 0 && options.format == FORMAT_BINARY) {
+        printf("Le format binaire n'est pas disponible avec --shards ou --checkpoint.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options.shards > 0 && options.checkpoint != NULL) {
+        printf("--checkpoint n'est pas disponible avec --shards.\n");
+        exit(EXIT_FAILURE);
+    }
+    ResultWriter writer;
+    if (options.format == FORMAT_BINARY && results_open(&writer, options.output, options.threads, options.seed) < 0) {
+        printf("Erreur lors de l'ouverture du fichier %s.\n", options.output);
+        exit(EXIT_FAILURE);
+    }
+
+    //Mode Monte Carlo : pas de question interactive, seulement la table des probabilites
+    //Les matchs ne sont enregistres qu'au format binaire, le resume texte n'ayant de sens que pour un tournoi
+    if (options.runs > 0) {
+        MonteCarlo mc;
+        Pool pool;
+        montecarlo_init(&mc, num_teams, options.runs, options.seed);
+        if (options.shards > 0) {
+            //Processus independants, chacun avec sa tranche de tournois et son propre pool
+            STATS_START(run);
+            if (shard_run(&mc, options.shards, options.threads) < 0) {
+                printf("Echec de la simulation repartie sur %d processus.\n", options.shards);
+                exit(EXIT_FAILURE);
+            }
+            STATS_PHASE(STATS_RUN, run);
+        } else {
+            STATS_START(spawn);
+            pool_init(&pool, options.threads);
+            STATS_PHASE(STATS_SPAWN, spawn);
+            STATS_START(run);
+            if (options.checkpoint != NULL) {
+                checkpoint_run(&mc, &pool, options.checkpoint, options.resume, options.interval);
+            } else {
+                montecarlo_run(&mc, &pool);
+            }
+            STATS_PHASE(STATS_RUN, run);
+            STATS_START(join);
+            pool_destroy(&pool);
+            STATS_PHASE(STATS_JOIN, join);
+        }
+        STATS_START(save);
+        if (results != NULL) {
+            results_close(&writer);
+        }
+        STATS_PHASE(STATS_SAVE, save);
+        montecarlo_print(&mc, stdout);
+        montecarlo_free(&mc);
+        if (options.engine == ENGINE_TABLE) {
+            table_free(&outcomes);
+        }
+        free_memory();
+        stats_dump();
+        return EXIT_SUCCESS;
+    }
+
+    //Entree standard sans tampon : le mode manuel lit la suite avec read(2), rien ne doit rester dans le tampon de stdio
+    setvbuf(stdin, NULL, _IONBF, 0);
     int manual = 1;
     do {
         printf("Choisir le mode de jeu : [1]:Mode simulation concurrente | [2]:Mode manuel \n");
         scanf("%d",&manual);
     }while(manual != 1 && manual != 2);
 
+    //Creation du tableau du tournoi, les matchs du premier tour sont prets
+    bracket_init(&bracket, num_teams, options.seed);
+
+    //Probabilites exactes de ce tableau, sans simulation
+    Analytic analytic;
+    if (options.analytic) {
+        analytic_init(&analytic, &bracket);
+        analytic_print(&analytic, stdout);
+    }
+
     if (manual == 1) { //Mode "Simulation concurrente"
         pthread_mutex_init(&mutex,NULL);
 
-        pthread_t threads[num_matchs_total]; //Tableau de threads de taille egale au nombre de match totale
-        while(num_match < num_matchs_total){
-            for (team1 = 0; team1 < num_teams; team1++)
-            {
-                pthread_mutex_lock(&mutex); //Verrouiler le mutex avant d'acceder au tableau teams_ramining
-                if(teams_remaining[team1] > 0){ //L'equipe team1 est prete a jouer le tour=teams_remaining[team1]
-                    tour = teams_remaining[team1];
-                    team2 = team1+1;
-                    while(team2 < num_teams){ //Rrouver l'equipe 2 qui a le meme numero de tour que team1
-                        if(teams_remaining[team2] == tour){
-                            //Creaion d'un match entre team1 et team2
-                            matchs[num_match] = (Match)malloc(sizeof(struct Match));
-                            matchs[num_match]->team1 = team1;
-                            matchs[num_match]->team2 = team2;
-                            matchs[num_match]->score1 = 0;
-                            matchs[num_match]->score2 = 0;
-                            matchs[num_match]->tour = teams_remaining[team2];
-                            //Mettre a 0 les cases de teams_remaining d'indices team1 et team2, signifie qu'ils sont en train de jouer un match
-                            teams_remaining[team1] = 0;
-                            teams_remaining[team2] = 0;
-                            //Creation d'un thread pour ce match
-                            pthread_create(&threads[num_match], NULL, simulate_match, matchs[num_match]);
-                            num_match++;
-                            team2++;
-                            break;
-                        }
-                        team2++;
-                    }
-                }
-                pthread_mutex_unlock(&mutex);//Deverouillage du mutex
-            }
+        //Pool de workers persistant : chaque match termine soumet lui-meme le match suivant du tableau
+        //Les workers publient leurs evenements dans le journal asynchrone, un seul thread les ecrit
+        EventLog log;
+        FILE *out = stdout;
+        if (options.log != NULL && (out = fopen(options.log, "w")) == NULL) {
+            printf("Erreur lors de l'ouverture du fichier %s.\n", options.log);
+            exit(EXIT_FAILURE);
         }
-
-        for (int i = 0; i < num_matchs_total; i++)
-        {
-            pthread_join(threads[i], NULL);
+        //En temps reel (--live), les matchs avancent d'une minute a chaque tick de l'horloge partagee
+        Pool pool;
+        LiveClock clock;
+        STATS_START(spawn);
+        eventlog_start(&log, options.threads, out);
+        pool_init(&pool, options.threads);
+        if (options.live > 0) {
+            live_start(&clock, options.live, &pool, bracket.num_matchs, 1);
+            bracket.play = live_match;
+        }
+        STATS_PHASE(STATS_SPAWN, spawn);
+        STATS_START(run);
+        bracket_run(&bracket, &pool);
+        STATS_PHASE(STATS_RUN, run);
+        STATS_START(join);
+        if (options.live > 0) {
+            live_stop(&clock);
+        }
+        pool_destroy(&pool);
+        eventlog_stop(&log);
+        STATS_PHASE(STATS_JOIN, join);
+        if (out != stdout) {
+            fclose(out);
         }
         pthread_mutex_destroy(&mutex);
     }else { //Mode Manuel
-        while(num_match<num_matchs_total) {
-            team1=0;
-            team2=0;
-            while(team1<num_teams && team2 < num_teams) {
-                while (teams_remaining[team1] <= 0) { team1++; }
-                team2 = team1 + 1;
-                while (teams_remaining[team2] <= 0) { team2++; }
-                matchs[num_match] = (Match) malloc(sizeof(struct Match));
-                matchs[num_match]->team1 = team1;
-                matchs[num_match]->team2 = team2;
-                matchs[num_match]->score1 = 0;
-                matchs[num_match]->score2 = 0;
-                matchs[num_match]->tour = tour;
-                play_match(matchs[num_match]);
-                num_match++;
-                team1= team2 + 1;
-            }
-            tour++;
-        }
+        //Tous les matchs prets sont joues ensemble sur une boucle d'evenements, une seconde par minute sauf avec --live
+        STATS_START(run);
+        manual_run(&bracket, options.analytic ? &analytic : NULL, options.live > 0 ? options.live : 1000);
+        STATS_PHASE(STATS_RUN, run);
     }
 
-    //Ecriture du resumé sur fichier
-    save_matchs(team_names, matchs, num_match);
+    //Ecriture du resumé sur fichier, ou fin du fichier binaire deja ecrit au fil des matchs
+    STATS_START(save);
+    if (results != NULL) {
+        results_close(&writer);
+    } else {
+        save_matchs(options.output, bracket.matchs, bracket.num_matchs);
+    }
+    STATS_PHASE(STATS_SAVE, save);
 
-    //Liberation memoire des deux tableaux
+    //Liberation memoire des deux tableaux et du tableau du tournoi
+    if (options.analytic) {
+        analytic_free(&analytic);
+    }
+    bracket_free(&bracket);
+    if (options.engine == ENGINE_TABLE) {
+        table_free(&outcomes);
+    }
     free_memory();
+    stats_dump();
 
-    return 1;
+    return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include "manual.h"
+#include "eventlog.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/**
+*@brief Affiche les commandes du mode manuel.
+*@return vide.
+*/
+static void manual_help(void) {
+    printf("Commandes : <match> 1 (l'equipe 1 marque) | <match> 2 (l'equipe 2 marque) | <match> 0 (finir le match) | <match> <score1> <score2> (choisir le score)\n");
+}
+
+/**
+*@brief Donne le coup d'envoi d'un match pret : il sera joue a chaque tick jusqu'a la fin du temps reglementaire.
+*@param m Le mode manuel.
+*@param id La case du match dans le tableau.
+*@return vide.
+*/
+static void manual_start(Manual *m, int id) {
+    ManualMatch *mm = &m->matchs[id];
+    Match match = &m->bracket->matchs[id];
+
+    mm->match = match;
+    mm->minute = 0;
+#ifdef WITH_STATS
+    mm->start = stats_enabled ? stats_now() : 0;
+#endif
+    m->active[m->num_active++] = id;
+    printf("Match %d : %.*s VS %.*s [TOUR %d]\n", id + 1, TEAM(match->team1), TEAM(match->team2), match->tour);
+    log_event(EV_DEBUT, match, 0);
+}
+
+/**
+*@brief Termine un match comme simulate_match (tirs au but si egalite, qualification du vainqueur), puis fige son resultat dans les probabilites exactes.
+*@param m Le mode manuel.
+*@param mm Le match, dont le temps reglementaire est fini ou dont le score a ete choisi.
+*@return vide.
+*/
+static void manual_finish(Manual *m, ManualMatch *mm) {
+    Match match = mm->match;
+
+    penalty_shootout(match, 1);
+    mm->minute = -1;
+    report_match(match);
+    STATS_ROUND(match->tour, mm->start);
+    log_event(EV_FIN, match, 0);
+    if (m->analytic != NULL) {
+        analytic_lock(m->analytic, match - m->bracket->matchs, match->score1 > match->score2 ? match->team1 : match->team2);
+        analytic_print_top(m->analytic, 5);
+    }
+}
+
+/**
+*@brief Joue les minutes suivantes d'un match en cours, et le termine a la fin du temps reglementaire.
+*@param m Le mode manuel.
+*@param mm Le match.
+*@param minutes Le nombre de minutes a jouer.
+*@return vide.
+*/
+static void manual_play(Manual *m, ManualMatch *mm, uint64_t minutes) {
+    while (minutes-- > 0 && mm->minute < match_duration) {
+        mm->minute++;
+        play_minute(mm->match, mm->minute, 1);
+    }
+    if (mm->minute >= match_duration) {
+        manual_finish(m, mm);
+    }
+}
+
+/**
+*@brief Lance tous les matchs devenus prets.
+*@param m Le mode manuel.
+*@return vide.
+*/
+static void manual_launch(Manual *m) {
+    int id;
+    while ((id = bracket_poll(m->bracket)) >= 0) {
+        manual_start(m, id);
+    }
+}
+
+/**
+*@brief Avance tous les matchs en cours de ticks minutes, et retire de la liste les matchs termines.
+*@param m Le mode manuel.
+*@param ticks Le nombre d'expirations du timerfd depuis la derniere lecture (plus d'une si la boucle a pris du retard).
+*@return vide.
+*/
+static void manual_tick(Manual *m, uint64_t ticks) {
+    int kept = 0;
+    for (int i = 0; i < m->num_active; i++) {
+        ManualMatch *mm = &m->matchs[m->active[i]];
+        if (mm->minute >= 0) {
+            manual_play(m, mm, ticks);
+        }
+        if (mm->minute >= 0) {
+            m->active[kept++] = m->active[i];
+        }
+    }
+    m->num_active = kept;
+}
+
+/**
+*@brief Execute une commande de l'operateur sur un match en cours.
+*@param m Le mode manuel.
+*@param line La commande, sans fin de ligne.
+*@return vide.
+*/
+static void manual_command(Manual *m, const char *line) {
+    int k, a, b;
+    int n = sscanf(line, "%d %d %d", &k, &a, &b);
+
+    if (n < 0) { //ligne vide
+        return;
+    }
+    if (n < 2) {
+        manual_help();
+        return;
+    }
+    if (k < 1 || k > m->bracket->num_matchs || m->matchs[k - 1].minute < 0) {
+        printf("Le match %d n'est pas en cours\n", k);
+        return;
+    }
+    ManualMatch *mm = &m->matchs[k - 1];
+    Match match = mm->match;
+    if (n == 3) { //Score choisi : le match se termine tout de suite
+        if (a < 0 || b < 0 || a == b) {
+            printf("Veuillez choisir un score sans egalite\n");
+            return;
+        }
+        match->score1 = a;
+        match->score2 = b;
+        manual_finish(m, mm);
+    } else if (a == 0) { //Accelerer : les minutes restantes sont jouees sans attendre l'horloge
+        manual_play(m, mm, match_duration);
+    } else if (a == 1 || a == 2) {
+        if (a == 1) {
+            match->score1++;
+        } else {
+            match->score2++;
+        }
+        log_event(EV_BUT, match, mm->minute < match_duration ? mm->minute + 1 : match_duration);
+    } else {
+        manual_help();
+    }
+}
+
+/**
+ *@brief Drapeaux d'origine de l'entree standard, -1 s'ils n'ont pas ete modifies. Ils sont restaures par
+ * manual_restore a la fin du mode manuel, et aussi par atexit si le programme s'arrete sur une erreur :
+ * le drapeau O_NONBLOCK est porte par la description de fichier, partagee avec le terminal de l'utilisateur.
+*/
+static int manual_flags = -1;
+
+/**
+*@brief Rend a l'entree standard ses drapeaux d'origine.
+*@return vide.
+*/
+static void manual_restore(void) {
+    if (manual_flags >= 0) {
+        fcntl(STDIN_FILENO, F_SETFL, manual_flags);
+        manual_flags = -1;
+    }
+}
+
+/**
+*@brief Execute la commande accumulee dans la ligne en cours, puis vide la ligne.
+*@param m Le mode manuel.
+*@return vide.
+*/
+static void manual_line(Manual *m) {
+    m->line[m->used] = '\0';
+    manual_command(m, m->line);
+    m->used = 0;
+}
+
+/**
+*@brief Lit sans attendre, avec read(2), toutes les commandes disponibles sur l'entree standard. Une ligne incomplete est gardee pour la lecture suivante ; a la fin du fichier (ou sur une erreur de lecture), l'entree standard n'est plus surveillee.
+*@param m Le mode manuel.
+*@return vide.
+*/
+static void manual_input(Manual *m) {
+    char buf[MANUAL_LINE];
+    ssize_t n;
+
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                manual_line(m);
+            } else if (m->used < MANUAL_LINE - 1) {
+                m->line[m->used++] = buf[i];
+            }
+        }
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return; // plus rien a lire pour l'instant : epoll previendra
+    }
+    if (m->used > 0) {
+        manual_line(m);
+    }
+    if (m->input) {
+        epoll_ctl(m->epoll, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+        m->input = 0;
+    }
+}
+
+/**
+*@brief Joue tout le tournoi en mode manuel : les matchs prets sont lances ensemble, avancent d'une minute a chaque tick et recoivent les commandes de l'operateur des qu'elles sont tapees.
+*@param b Le tableau du tournoi, tel que prepare par bracket_init.
+*@param analytic Les probabilites exactes du tableau, affichees apres chaque resultat, ou NULL.
+*@param scale_ms La duree reelle d'une minute simulee, en millisecondes.
+*@return vide.
+*/
+void manual_run(Bracket *b, Analytic *analytic, long scale_ms) {
+    Manual m;
+    struct epoll_event ev;
+    struct epoll_event events[2];
+    struct itimerspec period = {{scale_ms / 1000, (scale_ms % 1000) * 1000000L}, {scale_ms / 1000, (scale_ms % 1000) * 1000000L}};
+
+    memset(&m, 0, sizeof(Manual));
+    m.bracket = b;
+    m.analytic = analytic;
+    m.matchs = (ManualMatch*) calloc(b->num_matchs, sizeof(ManualMatch));
+    m.active = (int*) malloc(b->num_matchs * sizeof(int));
+    for (int i = 0; i < b->num_matchs; i++) {
+        m.matchs[i].minute = -1;
+    }
+    m.epoll = epoll_create1(EPOLL_CLOEXEC);
+    m.timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (m.epoll < 0 || m.timer < 0 || timerfd_settime(m.timer, 0, &period, NULL) < 0) {
+        printf("Erreur lors de la creation de la boucle d'evenements.\n");
+        exit(EXIT_FAILURE);
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = m.timer;
+    epoll_ctl(m.epoll, EPOLL_CTL_ADD, m.timer, &ev);
+
+    //Entree standard non bloquante : chaque reveil lit tout ce qui est arrive, sans jamais attendre une fin de ligne
+    //Un fichier ordinaire ne peut pas etre surveille par epoll : ses commandes sont lues des le premier tour
+    manual_flags = fcntl(STDIN_FILENO, F_GETFL);
+    if (manual_flags >= 0) {
+        atexit(manual_restore);
+        fcntl(STDIN_FILENO, F_SETFL, manual_flags | O_NONBLOCK);
+    }
+    ev.data.fd = STDIN_FILENO;
+    m.input = epoll_ctl(m.epoll, EPOLL_CTL_ADD, STDIN_FILENO, &ev) == 0;
+
+    manual_help();
+    manual_launch(&m);
+    manual_input(&m);
+    manual_launch(&m);
+    fflush(stdout);
+    while (b->done < b->num_matchs) {
+        int n = epoll_wait(m.epoll, events, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            printf("Erreur lors de l'attente des evenements.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == m.timer) {
+                uint64_t ticks;
+                if (read(m.timer, &ticks, sizeof(ticks)) == sizeof(ticks)) {
+                    manual_tick(&m, ticks);
+                }
+            } else {
+                manual_input(&m);
+            }
+        }
+        manual_launch(&m);
+        fflush(stdout);
+    }
+
+    manual_restore();
+    close(m.timer);
+    close(m.epoll);
+    free(m.active);
+    free(m.matchs);
+}
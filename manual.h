@@ -0,0 +1,46 @@
+#ifndef OS_MANUAL_H
+#define OS_MANUAL_H
+
+#include "fonctions.h"
+#include "bracket.h"
+#include "analytic.h"
+
+/**
+ *@brief Longueur maximale d'une commande, fin de ligne comprise
+*/
+#define MANUAL_LINE 256
+
+/**
+ *@brief Etat d'un match du mode manuel
+*/
+typedef struct ManualMatch{
+    Match match;
+    int minute;         // derniere minute jouee, -1 si le match n'est pas en cours
+    uint64_t start;     // debut du match pour les statistiques (--stats)
+}ManualMatch;
+
+/**
+ *@brief Mode manuel : tous les matchs prets sont joues en meme temps par une seule boucle d'evenements (epoll),
+ * qui surveille l'entree standard et un timerfd donnant une minute simulee par tick. Un tour dure donc la duree
+ * d'un match, quel que soit son nombre de matchs, et une commande est traitee des qu'elle arrive.
+ * Les matchs sont designes par leur numero, affiche au coup d'envoi (case du tableau + 1) :
+ *   k 1 / k 2     l'equipe 1 / l'equipe 2 du match k marque
+ *   k 0           le match k est joue jusqu'au bout sans attendre l'horloge
+ *   k S1 S2       le match k se termine sur le score S1 - S2 (sans egalite)
+*/
+typedef struct Manual{
+    Bracket *bracket;
+    Analytic *analytic;     // probabilites exactes mises a jour a chaque resultat, NULL sans --analytic
+    ManualMatch *matchs;    // une entree par case du tableau
+    int *active;            // cases des matchs lances, compactee a chaque tick
+    int num_active;
+    int epoll;
+    int timer;              // timerfd, un tick par minute simulee
+    int input;              // 1 tant que l'entree standard est surveillee
+    char line[MANUAL_LINE]; // commande en cours de lecture
+    size_t used;
+}Manual;
+
+void manual_run(Bracket *b, Analytic *analytic, long scale_ms);
+
+#endif
@@ -0,0 +1,317 @@
+#include "montecarlo.h"
+#include "batch.h"
+#include "bracket.h"
+#include "results.h"
+
+/**
+ *@brief Nombre cible de matchs par lot pour le moteur par lots
+*/
+#define BATCH_LANES 4096
+
+/**
+ *@brief Nombre de lots par worker : assez pour que le dernier lot de chaque worker ne laisse les autres inactifs qu'une petite fraction du temps
+*/
+#define CHUNKS_PER_WORKER 32
+
+/**
+ *@brief Lot de tournois simule par une tache du pool, avec ses propres compteurs
+*/
+typedef struct Chunk{
+    MonteCarlo *mc;
+    long first;         // premier tournoi du lot
+    long last;          // dernier tournoi du lot (exclu)
+    long **reached;     // compteurs propres a chaque worker, fusionnes apres la fin de toutes les taches
+}Chunk;
+
+/**
+*@brief Horloge monotone, pour l'echantillonnage des durees de matchs.
+*@return Le temps courant en nanosecondes.
+*/
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+*@brief Durees echantillonnees des matchs d'un tournoi (MonteCarlo.latency).
+*@param mc La simulation.
+*@param t Le numero du tournoi.
+*@return Les durees des matchs du tournoi, indicees comme le Bracket, ou NULL si le tournoi n'est pas echantillonne.
+*/
+static double *sampled(MonteCarlo *mc, long t) {
+    if (mc->latency == NULL || t % mc->latency_every != 0) {
+        return NULL;
+    }
+    return &mc->latency[(size_t) (t / mc->latency_every) * (mc->size - 1)];
+}
+
+/**
+*@brief Variante de montecarlo_chunk pour le moteur par lots : un groupe de tournois avance tour par tour, et tous les matchs d'un meme tour du groupe sont simules ensemble dans un Batch. La duree echantillonnee d'un match est celle de son lot, divisee par le nombre de matchs du lot.
+*@param c Le lot de tournois a simuler.
+*@return vide.
+*/
+static void montecarlo_chunk_batch(Chunk *c) {
+    MonteCarlo *mc = c->mc;
+    long *reached = c->reached[pool_worker_id()];
+    int width = mc->num_rounds + 1;
+    int group = BATCH_LANES / (mc->size / 2);
+    if (group < 1) {
+        group = 1;
+    }
+    int *perm = (int*) malloc(mc->num_teams * sizeof(int));
+    int *alive = (int*) malloc((size_t) group * mc->size * sizeof(int));
+    uint64_t *prefix = (uint64_t*) malloc(group * sizeof(uint64_t));
+    Batch b;
+    batch_init(&b, group * (mc->size / 2));
+
+    for (long first = c->first; first < c->last; first += group) {
+        int count = c->last - first < group ? (int) (c->last - first) : group;
+        for (int g = 0; g < count; g++) {
+            bracket_draw(mc->num_teams, mc->size, mc->seed, first + g, perm, &alive[(size_t) g * mc->size]);
+            prefix[g] = rng_prefix(mc->seed, first + g);
+        }
+        int id = 0; // indice du premier match du tour, comme dans le Bracket
+        int remaining = mc->size;
+        for (int tour = 1; remaining > 1; tour++) {
+            batch_clear(&b);
+            for (int g = 0; g < count; g++) {
+                int *a = &alive[(size_t) g * mc->size];
+                for (int k = 0; k < remaining / 2; k++) {
+                    if (a[2 * k + 1] >= 0) { // les exemptions ne prennent pas de place dans le lot
+                        int lane = batch_add(&b, a[2 * k], a[2 * k + 1], tour, prefix[g], id + k);
+                        if (teams.ratings != NULL) {
+                            const Odds *o = match_odds(a[2 * k], a[2 * k + 1]);
+                            batch_rate(&b, lane, o->goal1 / 10000.0, o->goal2 / 10000.0, o->pen1 / 10000.0, o->pen2 / 10000.0);
+                        }
+                    }
+                }
+            }
+            double start = mc->latency != NULL ? now_ns() : 0;
+            batch_run(&b, match_duration);
+            double per_match = mc->latency != NULL && b.count > 0 ? (now_ns() - start) / b.count : 0;
+            int lane = 0;
+            for (int g = 0; g < count; g++) {
+                int *a = &alive[(size_t) g * mc->size];
+                double *latency = sampled(mc, first + g);
+                for (int k = 0; k < remaining / 2; k++) {
+                    if (a[2 * k + 1] >= 0 && latency != NULL) {
+                        latency[id + k] = per_match;
+                    }
+                    if (a[2 * k + 1] >= 0 && results != NULL) {
+                        struct Match m = {b.team1[lane], b.team2[lane], b.score1[lane], b.score2[lane], tour, {{0}}};
+                        results_record(results, first + g, id + k, &m);
+                    }
+                    a[k] = a[2 * k + 1] >= 0 ? batch_winner(&b, lane++) : a[2 * k];
+                    reached[(size_t) a[k] * width + tour]++;
+                }
+            }
+            id += remaining / 2;
+            remaining /= 2;
+        }
+    }
+    STATS_ADD(matches, (uint64_t) (c->last - c->first) * (mc->num_teams - 1));
+    batch_free(&b);
+    free(prefix);
+    free(alive);
+    free(perm);
+}
+
+/**
+*@brief Simule un lot de tournois sans aucun affichage ni verrou : tirage du tableau, puis tour par tour jusqu'au vainqueur, en comptant les tours atteints par chaque equipe.
+*@param arg Pointeur sur le Chunk a simuler.
+*@return NULL
+*/
+static void *montecarlo_chunk(void *arg) {
+    Chunk *c = (Chunk*) arg;
+    MonteCarlo *mc = c->mc;
+    long *reached = c->reached[pool_worker_id()];
+    int width = mc->num_rounds + 1;
+    struct Match m;
+
+    if (options.engine == ENGINE_BATCH) {
+        montecarlo_chunk_batch(c);
+        return NULL;
+    }
+    int *perm = (int*) malloc(mc->num_teams * sizeof(int));
+    int *alive = (int*) malloc(mc->size * sizeof(int));
+    for (long t = c->first; t < c->last; t++) {
+        //Tirage du tableau de ce tournoi
+        bracket_draw(mc->num_teams, mc->size, mc->seed, t, perm, alive);
+        double *latency = sampled(mc, t);
+
+        //Les vainqueurs sont compactes en tete de alive a chaque tour, le match k a le meme indice que dans le Bracket
+        int id = 0;
+        int remaining = mc->size;
+        for (int tour = 1; remaining > 1; tour++) {
+            for (int k = 0; k < remaining / 2; k++) {
+                if (alive[2 * k + 1] < 0) { // exemption : l'equipe passe sans jouer
+                    alive[k] = alive[2 * k];
+                    reached[(size_t) alive[k] * width + tour]++;
+                    id++;
+                    continue;
+                }
+                m.team1 = alive[2 * k];
+                m.team2 = alive[2 * k + 1];
+                m.score1 = 0;
+                m.score2 = 0;
+                m.tour = tour;
+                rng_seed(&m.rng, mc->seed, t, id);
+                double start = latency != NULL ? now_ns() : 0;
+                alive[k] = run_match(&m, 0);
+                if (latency != NULL) {
+                    latency[id] = now_ns() - start;
+                }
+                if (results != NULL) {
+                    results_record(results, t, id, &m);
+                }
+                id++;
+                reached[(size_t) alive[k] * width + tour]++;
+            }
+            remaining /= 2;
+        }
+    }
+    STATS_ADD(matches, (uint64_t) (c->last - c->first) * (mc->num_teams - 1));
+    free(alive);
+    free(perm);
+    return NULL;
+}
+
+/**
+*@brief Prepare une simulation Monte Carlo.
+*@param mc La simulation a initialiser.
+*@param num_teams Le nombre d'equipes, au moins 2 ; le tableau est complete par des exemptions.
+*@param runs Le nombre de tournois a simuler.
+*@param seed La graine globale.
+*@return vide.
+*/
+void montecarlo_init(MonteCarlo *mc, int num_teams, long runs, uint64_t seed) {
+    mc->runs = runs;
+    mc->first = 0;
+    mc->num_teams = num_teams;
+    mc->seed = seed;
+    mc->size = bracket_size(num_teams);
+    mc->num_rounds = 0;
+    while ((1 << mc->num_rounds) < mc->size) {
+        mc->num_rounds++;
+    }
+    mc->reached = (long*) calloc((size_t) num_teams * (mc->num_rounds + 1), sizeof(long));
+    mc->latency = NULL;
+    mc->latency_every = 0;
+}
+
+/**
+*@brief Repartit les tournois first a first + count - 1 en lots sur le pool, chaque worker accumulant dans ses propres compteurs, puis ajoute les compteurs des workers a ceux de la simulation. Le resultat ne depend que de la graine, pas du nombre de workers ni du decoupage en lots : des appels successifs sur des intervalles consecutifs donnent les memes compteurs qu'un seul appel.
+*@param mc La simulation.
+*@param pool Le pool de workers.
+*@param first Le premier tournoi.
+*@param count Le nombre de tournois.
+*@return vide.
+*/
+void montecarlo_range(MonteCarlo *mc, Pool *pool, long first, long count) {
+    int width = mc->num_rounds + 1;
+    size_t cells = (size_t) mc->num_teams * width;
+    long num_chunks = (long) pool->num_workers * CHUNKS_PER_WORKER;
+    if (num_chunks > count) {
+        num_chunks = count > 0 ? count : 1;
+    }
+    Chunk *chunks = (Chunk*) malloc(num_chunks * sizeof(Chunk));
+    long **reached = (long**) malloc(pool->num_workers * sizeof(long*));
+
+    for (int w = 0; w < pool->num_workers; w++) {
+        reached[w] = (long*) calloc(cells, sizeof(long));
+    }
+    for (long i = 0; i < num_chunks; i++) {
+        chunks[i].mc = mc;
+        chunks[i].first = first + count * i / num_chunks;
+        chunks[i].last = first + count * (i + 1) / num_chunks;
+        chunks[i].reached = reached;
+        pool_submit(pool, montecarlo_chunk, &chunks[i]);
+    }
+    pool_wait(pool);
+
+    //Fusion des compteurs des workers ; toutes les equipes atteignent le tour 1
+    for (int team = 0; team < mc->num_teams; team++) {
+        mc->reached[(size_t) team * width] += count;
+    }
+    for (int w = 0; w < pool->num_workers; w++) {
+        for (size_t j = 0; j < cells; j++) {
+            mc->reached[j] += reached[w][j];
+        }
+        free(reached[w]);
+    }
+    free(reached);
+    free(chunks);
+}
+
+/**
+*@brief Simule les tournois first a first + runs - 1 de la simulation (voir montecarlo_range).
+*@param mc La simulation, dont les compteurs sont encore a zero.
+*@param pool Le pool de workers.
+*@return vide.
+*/
+void montecarlo_run(MonteCarlo *mc, Pool *pool) {
+    montecarlo_range(mc, pool, mc->first, mc->runs);
+}
+
+/**
+ *@brief Simulation dont les equipes sont en cours de tri dans montecarlo_print
+*/
+static MonteCarlo *sorted;
+
+/**
+*@brief Compare deux equipes par nombre de titres decroissant, puis par numero d'equipe.
+*@param a Pointeur sur le numero de la premiere equipe.
+*@param b Pointeur sur le numero de la seconde equipe.
+*@return Un entier negatif, nul ou positif, comme pour qsort.
+*/
+static int compare_titles(const void *a, const void *b) {
+    int ta = *(const int*) a;
+    int tb = *(const int*) b;
+    long wa = sorted->reached[ta * (sorted->num_rounds + 1) + sorted->num_rounds];
+    long wb = sorted->reached[tb * (sorted->num_rounds + 1) + sorted->num_rounds];
+    if (wa != wb) {
+        return wa < wb ? 1 : -1;
+    }
+    return ta - tb;
+}
+
+/**
+*@brief Affiche, pour chaque equipe, la probabilite d'atteindre chaque tour et de remporter le tournoi, les equipes etant triees par probabilite de titre decroissante.
+*@param mc La simulation terminee.
+*@param out La destination de la table.
+*@return vide.
+*/
+void montecarlo_print(MonteCarlo *mc, FILE *out) {
+    int width = mc->num_rounds + 1;
+    int *order = (int*) malloc(mc->num_teams * sizeof(int));
+
+    for (int i = 0; i < mc->num_teams; i++) {
+        order[i] = i;
+    }
+    sorted = mc;
+    qsort(order, mc->num_teams, sizeof(int), compare_titles);
+
+    fprintf(out, "%-25s", "Equipe");
+    for (int r = 2; r <= mc->num_rounds; r++) {
+        fprintf(out, " Tour %-3d", r);
+    }
+    fprintf(out, " Vainqueur\n");
+    for (int i = 0; i < mc->num_teams; i++) {
+        fprintf(out, "%-25.*s", TEAM_MAX(order[i], 25));
+        for (int r = 1; r <= mc->num_rounds; r++) {
+            fprintf(out, " %7.3f%%", 100.0 * mc->reached[order[i] * width + r] / mc->runs);
+        }
+        fprintf(out, "\n");
+    }
+    free(order);
+}
+
+/**
+*@brief Libere les compteurs de la simulation.
+*@param mc La simulation.
+*@return vide.
+*/
+void montecarlo_free(MonteCarlo *mc) {
+    free(mc->reached);
+}
@@ -0,0 +1,30 @@
+#ifndef OS_MONTECARLO_H
+#define OS_MONTECARLO_H
+
+#include "fonctions.h"
+#include "pool.h"
+
+/**
+ *@brief Simulation Monte Carlo : runs tournois complets, chacun avec son propre tirage du tableau.
+ * reached[team * (num_rounds + 1) + r] compte les tournois ou l'equipe a atteint le tour r + 1 ;
+ * la derniere colonne (r = num_rounds) compte les titres.
+*/
+typedef struct MonteCarlo{
+    long runs;          // nombre de tournois a simuler
+    long first;         // numero du premier tournoi simule, 0 sauf pour une tranche (--shards)
+    int num_teams;      // nombre d'equipes
+    int size;           // places du premier tour, bracket_size(num_teams), completees par des exemptions
+    int num_rounds;     // nombre de tours, log2(size)
+    uint64_t seed;      // graine, le tournoi t utilise les flux (seed, t, .)
+    long *reached;      // compteurs fusionnes, num_teams * (num_rounds + 1)
+    double *latency;    // banc d'essai : duree (ns) de chaque match des tournois t multiples de latency_every, a l'indice (t / latency_every) * (size - 1) + match ; NULL sinon
+    long latency_every;
+}MonteCarlo;
+
+void montecarlo_init(MonteCarlo *mc, int num_teams, long runs, uint64_t seed);
+void montecarlo_range(MonteCarlo *mc, Pool *pool, long first, long count);
+void montecarlo_run(MonteCarlo *mc, Pool *pool);
+void montecarlo_print(MonteCarlo *mc, FILE *out);
+void montecarlo_free(MonteCarlo *mc);
+
+#endif
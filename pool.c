@@ -0,0 +1,276 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ *@brief Numero du worker qui execute le thread courant (-1 hors du pool)
+*/
+static __thread int worker_id = -1;
+
+/**
+ *@brief Pool auquel appartient le thread courant (NULL hors du pool)
+*/
+static __thread Pool *worker_pool = NULL;
+
+/**
+*@brief Initialise une file vide.
+*@param d La file.
+*@return vide.
+*/
+static void deque_init(Deque *d) {
+    d->cap = 64;
+    d->tasks = (Task*) malloc(d->cap * sizeof(Task));
+    d->top = 0;
+    d->bottom = 0;
+    pthread_mutex_init(&d->lock, NULL);
+}
+
+/**
+*@brief Ajoute une tache en bas de la file, en doublant le tampon s'il est plein.
+*@param d La file.
+*@param t La tache a ajouter.
+*@return vide.
+*/
+static void deque_push(Deque *d, Task t) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top == d->cap) {
+        Task *tasks = (Task*) malloc(2 * d->cap * sizeof(Task));
+        for (int i = d->top; i < d->bottom; i++) {
+            tasks[i & (2 * d->cap - 1)] = d->tasks[i & (d->cap - 1)];
+        }
+        free(d->tasks);
+        d->tasks = tasks;
+        d->cap *= 2;
+    }
+    d->tasks[d->bottom & (d->cap - 1)] = t;
+    d->bottom++;
+    pthread_mutex_unlock(&d->lock);
+}
+
+/**
+*@brief Retire une tache de la file : en bas pour le proprietaire, en haut pour un voleur.
+*@param d La file.
+*@param t La tache retiree.
+*@param steal 1 si l'appelant vole la tache, 0 s'il est le proprietaire de la file.
+*@return 1 si une tache a ete retiree, 0 si la file etait vide.
+*/
+static int deque_take(Deque *d, Task *t, int steal) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        if (steal) {
+            *t = d->tasks[d->top & (d->cap - 1)];
+            d->top++;
+        } else {
+            d->bottom--;
+            *t = d->tasks[d->bottom & (d->cap - 1)];
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+/**
+*@brief Cherche une tache pour le worker id : d'abord dans les taches qui lui sont attribuees (dans l'ordre de soumission), puis dans sa propre file, puis en volant dans celles des autres workers.
+*@param p Le pool.
+*@param id Le numero du worker.
+*@param t La tache trouvee.
+*@return 2 si la tache vient de l'inbox du worker, 1 si elle vient d'une file, 0 si aucune tache n'a ete trouvee.
+*/
+static int pool_find(Pool *p, int id, Task *t) {
+    if (deque_take(&p->inboxes[id], t, 1)) {
+        return 2;
+    }
+    if (deque_take(&p->deques[id], t, 0)) {
+        return 1;
+    }
+    for (int i = 1; i < p->num_workers; i++) {
+        if (deque_take(&p->deques[(id + i) % p->num_workers], t, 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+*@brief Boucle d'un worker : execute les taches tant qu'il y en a, puis dort sur la variable de condition du pool jusqu'a la prochaine soumission.
+*@param arg Le pool ; le numero du worker est deduit de sa position dans p->workers.
+*@return NULL
+*/
+static void *pool_worker(void *arg) {
+    Pool *p = (Pool*) arg;
+    Task t;
+
+    worker_pool = p;
+    pthread_mutex_lock(&p->lock); //Attend que pool_init ait rempli p->workers
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->num_workers; i++) {
+        if (pthread_equal(p->workers[i], pthread_self())) {
+            worker_id = i;
+        }
+    }
+
+    while (1) {
+        int found = pool_find(p, worker_id, &t);
+        if (found) {
+            atomic_fetch_sub(found == 2 ? &p->assigned[worker_id] : &p->queued, 1);
+            t.fn(t.arg);
+            if (atomic_fetch_sub(&p->pending, 1) == 1) {
+                pthread_mutex_lock(&p->lock);
+                pthread_cond_broadcast(&p->idle);
+                pthread_mutex_unlock(&p->lock);
+            }
+            continue;
+        }
+        pthread_mutex_lock(&p->lock);
+        atomic_fetch_add(&p->sleeping, 1);
+        //Les taches attribuees aux autres workers ne reveillent pas celui-ci
+        while (atomic_load(&p->queued) == 0 && atomic_load(&p->assigned[worker_id]) == 0 && !p->stop) {
+            pthread_cond_wait(&p->cond, &p->lock);
+        }
+        atomic_fetch_sub(&p->sleeping, 1);
+        if (p->stop && atomic_load(&p->queued) == 0 && atomic_load(&p->assigned[worker_id]) == 0) {
+            pthread_mutex_unlock(&p->lock);
+            break;
+        }
+        pthread_mutex_unlock(&p->lock);
+    }
+    return NULL;
+}
+
+/**
+*@brief Nombre de workers par defaut : le nombre de coeurs en ligne.
+*@return Le nombre de coeurs, au moins 1.
+*/
+int pool_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+}
+
+/**
+*@brief Cree le pool et demarre ses workers.
+*@param p Le pool a initialiser.
+*@param num_workers Le nombre de workers (au moins 1).
+*@return vide.
+*/
+void pool_init(Pool *p, int num_workers) {
+    p->num_workers = num_workers > 0 ? num_workers : 1;
+    p->workers = (pthread_t*) malloc(p->num_workers * sizeof(pthread_t));
+    p->deques = (Deque*) malloc(p->num_workers * sizeof(Deque));
+    p->inboxes = (Deque*) malloc(p->num_workers * sizeof(Deque));
+    p->assigned = (atomic_int*) malloc(p->num_workers * sizeof(atomic_int));
+    atomic_init(&p->queued, 0);
+    atomic_init(&p->pending, 0);
+    atomic_init(&p->sleeping, 0);
+    atomic_init(&p->next, 0);
+    p->stop = 0;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    pthread_cond_init(&p->idle, NULL);
+
+    for (int i = 0; i < p->num_workers; i++) {
+        deque_init(&p->deques[i]);
+        deque_init(&p->inboxes[i]);
+        atomic_init(&p->assigned[i], 0);
+    }
+    //Le verrou empeche les workers de chercher leur numero avant que p->workers soit rempli
+    pthread_mutex_lock(&p->lock);
+    for (int i = 0; i < p->num_workers; i++) {
+        pthread_create(&p->workers[i], NULL, pool_worker, p);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+*@brief Soumet une tache. Depuis un worker du pool, elle est placee dans sa propre file ; sinon les files sont choisies a tour de role. Un worker endormi est reveille si besoin.
+*@param p Le pool.
+*@param fn La fonction a executer.
+*@param arg L'argument passe a fn.
+*@return vide.
+*/
+void pool_submit(Pool *p, void *(*fn)(void *), void *arg) {
+    Task t = {fn, arg};
+    int id = worker_pool == p ? worker_id : (int) (atomic_fetch_add(&p->next, 1) % p->num_workers);
+
+    atomic_fetch_add(&p->pending, 1);
+    deque_push(&p->deques[id], t);
+    atomic_fetch_add(&p->queued, 1);
+    if (atomic_load(&p->sleeping) > 0) {
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_signal(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+/**
+*@brief Soumet une tache a un worker precis : elle n'est jamais volee, et les taches attribuees au meme worker sont executees dans l'ordre de soumission. Tous les workers endormis sont reveilles, puisque seul le destinataire peut la prendre.
+*@param p Le pool.
+*@param worker Le numero du worker (pris modulo num_workers).
+*@param fn La fonction a executer.
+*@param arg L'argument passe a fn.
+*@return vide.
+*/
+void pool_submit_to(Pool *p, int worker, void *(*fn)(void *), void *arg) {
+    Task t = {fn, arg};
+
+    worker %= p->num_workers;
+    atomic_fetch_add(&p->pending, 1);
+    deque_push(&p->inboxes[worker], t);
+    atomic_fetch_add(&p->assigned[worker], 1);
+    if (atomic_load(&p->sleeping) > 0) {
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+/**
+*@brief Attend que toutes les taches soumises, y compris celles soumises par d'autres taches, soient terminees.
+*@param p Le pool.
+*@return vide.
+*/
+void pool_wait(Pool *p) {
+    pthread_mutex_lock(&p->lock);
+    while (atomic_load(&p->pending) > 0) {
+        pthread_cond_wait(&p->idle, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+*@brief Termine les taches restantes, arrete les workers et libere le pool.
+*@param p Le pool.
+*@return vide.
+*/
+void pool_destroy(Pool *p) {
+    pool_wait(p);
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->num_workers; i++) {
+        pthread_join(p->workers[i], NULL);
+    }
+    for (int i = 0; i < p->num_workers; i++) {
+        free(p->deques[i].tasks);
+        pthread_mutex_destroy(&p->deques[i].lock);
+        free(p->inboxes[i].tasks);
+        pthread_mutex_destroy(&p->inboxes[i].lock);
+    }
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->cond);
+    pthread_cond_destroy(&p->idle);
+    free(p->deques);
+    free(p->inboxes);
+    free(p->assigned);
+    free(p->workers);
+}
+
+/**
+*@brief Numero du worker courant, utile pour indexer des donnees propres a chaque worker.
+*@return Le numero du worker dans [0, num_workers), ou -1 si l'appelant n'est pas un worker.
+*/
+int pool_worker_id(void) {
+    return worker_id;
+}
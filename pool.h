@@ -0,0 +1,55 @@
+#ifndef OS_POOL_H
+#define OS_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ *@brief Tache executee par le pool : meme signature qu'une fonction de thread pthread.
+*/
+typedef struct Task{
+    void *(*fn)(void *);
+    void *arg;
+}Task;
+
+/**
+ *@brief File double propre a un worker. Le proprietaire empile et depile en bas (LIFO),
+ * les autres workers volent en haut (FIFO). Chaque file a son propre verrou, il n'y a donc
+ * pas de verrou global sur le chemin normal d'une tache.
+*/
+typedef struct Deque{
+    Task *tasks;          // tampon circulaire
+    int cap;              // capacite du tampon (puissance de 2)
+    int top;              // indice de vol
+    int bottom;           // indice du proprietaire
+    pthread_mutex_t lock;
+}Deque;
+
+/**
+ *@brief Pool de threads persistant, une file par worker avec vol de travail.
+*/
+typedef struct Pool{
+    int num_workers;
+    pthread_t *workers;
+    Deque *deques;
+    Deque *inboxes;       // taches attribuees a un worker precis (pool_submit_to), jamais volees
+    atomic_int queued;    // taches presentes dans les files
+    atomic_int *assigned; // taches presentes dans l'inbox de chaque worker
+    atomic_int pending;   // taches soumises et pas encore terminees
+    atomic_int sleeping;  // workers endormis sur cond
+    atomic_uint next;     // repartition tourniquet des soumissions externes
+    int stop;
+    pthread_mutex_t lock; // protege le sommeil des workers et l'attente de pool_wait
+    pthread_cond_t cond;  // reveil des workers inactifs
+    pthread_cond_t idle;  // signalee quand pending retombe a 0
+}Pool;
+
+int pool_default_threads(void);
+void pool_init(Pool *p, int num_workers);
+void pool_submit(Pool *p, void *(*fn)(void *), void *arg);
+void pool_submit_to(Pool *p, int worker, void *(*fn)(void *), void *arg);
+void pool_wait(Pool *p);
+void pool_destroy(Pool *p);
+int pool_worker_id(void);
+
+#endif
@@ -0,0 +1,157 @@
+#include "results.h"
+#include "fonctions.h"
+#include "pool.h"
+
+/**
+ *@brief Nombre d'enregistrements par tampon (1 Mio, multiple de RESULTS_ALIGN)
+*/
+#define RESULTS_BUFFER (1048576 / sizeof(MatchRecord))
+
+/**
+ *@brief Fichier de resultats binaire actif, NULL si les resultats ne sont pas ecrits en continu
+*/
+ResultWriter *results = NULL;
+
+/**
+*@brief Ecrit entierement un bloc dans le fichier, en reprenant apres une ecriture partielle.
+*@param fd Le descripteur du fichier.
+*@param data Les donnees.
+*@param size La taille des donnees.
+*@return 0 en cas de succes, -1 en cas d'erreur.
+*/
+static int write_all(int fd, const void *data, size_t size) {
+    const char *p = (const char*) data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/**
+*@brief Cree le fichier binaire et y ecrit l'en-tete et la table des equipes, puis le rend actif pour results_record.
+*@param w L'ecrivain a initialiser.
+*@param path Le chemin du fichier.
+*@param num_workers Le nombre de workers qui enregistreront des matchs.
+*@param seed La graine de la simulation, recopiee dans l'en-tete.
+*@return 0 en cas de succes, -1 si le fichier ne peut pas etre ecrit.
+*/
+int results_open(ResultWriter *w, const char *path, int num_workers, uint64_t seed) {
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        return -1;
+    }
+
+    //En-tete et table des equipes, completes jusqu'a un multiple de RESULTS_ALIGN
+    size_t size = sizeof(ResultHeader);
+    for (int i = 0; i < num_teams; i++) {
+        size += sizeof(uint32_t) + teams.lengths[i];
+    }
+    size = (size + RESULTS_ALIGN - 1) / RESULTS_ALIGN * RESULTS_ALIGN;
+    char *head = (char*) calloc(1, size);
+    ResultHeader *h = (ResultHeader*) head;
+    memcpy(h->magic, RESULTS_MAGIC, 4);
+    h->version = RESULTS_VERSION;
+    h->record_size = sizeof(MatchRecord);
+    h->num_teams = num_teams;
+    h->match_duration = match_duration;
+    h->seed = seed;
+    h->records_offset = size;
+    char *p = head + sizeof(ResultHeader);
+    for (int i = 0; i < num_teams; i++) {
+        memcpy(p, &teams.lengths[i], sizeof(uint32_t));
+        memcpy(p + sizeof(uint32_t), team_name(i), teams.lengths[i]);
+        p += sizeof(uint32_t) + teams.lengths[i];
+    }
+    int err = write_all(w->fd, head, size);
+    free(head);
+    if (err < 0) {
+        close(w->fd);
+        return -1;
+    }
+
+    w->num_buffers = num_workers + 1;
+    w->buffers = (ResultBuffer*) malloc(w->num_buffers * sizeof(ResultBuffer));
+    for (int i = 0; i < w->num_buffers; i++) {
+        w->buffers[i].records = (MatchRecord*) aligned_alloc(RESULTS_ALIGN, RESULTS_BUFFER * sizeof(MatchRecord));
+        w->buffers[i].used = 0;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    results = w;
+    return 0;
+}
+
+/**
+*@brief Ecrit le contenu d'un tampon dans le fichier et le vide.
+*@pre Le verrou du fichier doit etre tenu par l'appelant.
+*@param w L'ecrivain.
+*@param b Le tampon.
+*@return vide.
+*/
+static void results_flush(ResultWriter *w, ResultBuffer *b) {
+    if (b->used > 0 && write_all(w->fd, b->records, b->used * sizeof(MatchRecord)) < 0) {
+        perror("Erreur d'ecriture des resultats");
+    }
+    b->used = 0;
+}
+
+/**
+*@brief Enregistre un match termine dans le tampon du worker appelant ; le tampon est ecrit dans le fichier quand il est plein.
+*@param w L'ecrivain.
+*@param tournament Le numero du tournoi.
+*@param match_id L'indice du match dans le tableau du tournoi.
+*@param match Le match termine.
+*@return vide.
+*/
+void results_record(ResultWriter *w, uint64_t tournament, uint32_t match_id, struct Match *match) {
+    int id = pool_worker_id();
+    int shared = id < 0 || id >= w->num_buffers - 1;
+    ResultBuffer *b = &w->buffers[shared ? w->num_buffers - 1 : id];
+
+    if (shared) {
+        pthread_mutex_lock(&w->lock);
+    }
+    MatchRecord *r = &b->records[b->used++];
+    memset(r, 0, sizeof(MatchRecord));
+    r->tournament = tournament;
+    r->match = match_id;
+    r->team1 = match->team1;
+    r->team2 = match->team2;
+    r->score1 = match->score1;
+    r->score2 = match->score2;
+    r->tour = match->tour;
+    if (b->used == (int) RESULTS_BUFFER) {
+        if (!shared) {
+            pthread_mutex_lock(&w->lock);
+        }
+        results_flush(w, b);
+        if (!shared) {
+            pthread_mutex_unlock(&w->lock);
+        }
+    }
+    if (shared) {
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+/**
+*@brief Ecrit les tampons restants et ferme le fichier. Les workers doivent avoir termine.
+*@param w L'ecrivain.
+*@return vide.
+*/
+void results_close(ResultWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    for (int i = 0; i < w->num_buffers; i++) {
+        results_flush(w, &w->buffers[i]);
+        free(w->buffers[i].records);
+    }
+    pthread_mutex_unlock(&w->lock);
+    pthread_mutex_destroy(&w->lock);
+    free(w->buffers);
+    close(w->fd);
+    results = NULL;
+}
@@ -0,0 +1,72 @@
+#ifndef OS_RESULTS_H
+#define OS_RESULTS_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ *@brief Format binaire des resultats (fichier .bin) :
+ * - un en-tete ResultHeader, suivi de la table des equipes (pour chaque equipe, sa longueur sur
+ *   4 octets puis son nom), complete par des zeros jusqu'a records_offset (multiple de 4096) ;
+ * - puis des enregistrements MatchRecord de taille fixe, dans l'ordre ou les matchs se terminent.
+ * Les entiers sont ecrits dans l'ordre natif de la machine (petit-boutiste sur x86).
+*/
+#define RESULTS_MAGIC "MSIM"
+#define RESULTS_VERSION 1
+#define RESULTS_ALIGN 4096
+
+/**
+ *@brief En-tete du fichier binaire de resultats
+*/
+typedef struct ResultHeader{
+    char magic[4];          // "MSIM"
+    uint16_t version;       // RESULTS_VERSION
+    uint16_t record_size;   // sizeof(MatchRecord)
+    uint32_t num_teams;     // nombre d'equipes de la table
+    uint32_t match_duration;// duree des matchs en minutes
+    uint64_t seed;          // graine de la simulation
+    uint64_t records_offset;// position du premier enregistrement
+}ResultHeader;
+
+/**
+ *@brief Enregistrement d'un match joue (les exemptions ne sont pas enregistrees)
+*/
+typedef struct MatchRecord{
+    uint64_t tournament;    // numero du tournoi (0 hors mode Monte Carlo)
+    uint32_t match;         // indice du match dans le tableau du tournoi
+    uint32_t team1;
+    uint32_t team2;
+    uint16_t score1;
+    uint16_t score2;
+    uint8_t tour;
+    uint8_t reserved[7];
+}MatchRecord;
+
+/**
+ *@brief Tampon d'enregistrements en attente d'ecriture, un par worker
+*/
+typedef struct ResultBuffer{
+    MatchRecord *records;   // aligne sur RESULTS_ALIGN
+    int used;
+}ResultBuffer;
+
+/**
+ *@brief Ecriture en continu des resultats : chaque worker remplit son propre tampon, qui est ecrit
+ * d'un bloc (taille multiple de RESULTS_ALIGN) sous le verrou du fichier quand il est plein.
+*/
+typedef struct ResultWriter{
+    int fd;
+    int num_buffers;        // un par worker, plus un pour les threads hors du pool
+    ResultBuffer *buffers;
+    pthread_mutex_t lock;   // protege l'ecriture dans le fichier et le tampon hors du pool
+}ResultWriter;
+
+struct Match;
+
+extern ResultWriter *results;
+
+int results_open(ResultWriter *w, const char *path, int num_workers, uint64_t seed);
+void results_record(ResultWriter *w, uint64_t tournament, uint32_t match_id, struct Match *match);
+void results_close(ResultWriter *w);
+
+#endif
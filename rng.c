@@ -0,0 +1,27 @@
+#include "rng.h"
+
+/**
+*@brief Partie de l'initialisation d'un flux qui ne depend que de la graine et du tournoi : les flux d'un meme tournoi la partagent (voir batch_add).
+*@param seed La graine globale (--seed).
+*@param tournament Le numero du tournoi.
+*@return Le prefixe : l'etat de splitmix64 du flux s est rng_prefix(seed, tournament) ^ s.
+*/
+uint64_t rng_prefix(uint64_t seed, uint64_t tournament) {
+    uint64_t x = rng_mix(seed + RNG_GAMMA) ^ tournament;
+    return rng_mix(x + RNG_GAMMA);
+}
+
+/**
+*@brief Initialise un flux independant a partir de la graine du programme, du numero de tournoi et du numero de flux (en general l'indice du match). L'etat de xoshiro est rempli par splitmix64, partant de rng_prefix(seed, tournament) ^ stream.
+*@param r Le generateur a initialiser.
+*@param seed La graine globale (--seed).
+*@param tournament Le numero du tournoi.
+*@param stream Le numero du flux dans ce tournoi.
+*@return vide.
+*/
+void rng_seed(Rng *r, uint64_t seed, uint64_t tournament, uint64_t stream) {
+    uint64_t x = rng_prefix(seed, tournament) ^ stream;
+    for (int i = 0; i < 4; i++) {
+        r->s[i] = rng_mix(x += RNG_GAMMA);
+    }
+}
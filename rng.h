@@ -0,0 +1,82 @@
+#ifndef OS_RNG_H
+#define OS_RNG_H
+
+#include <stdint.h>
+
+/**
+ *@brief Flux du generateur utilise pour le melange des equipes (les matchs utilisent leur indice)
+*/
+#define RNG_STREAM_SHUFFLE UINT64_MAX
+
+/**
+ *@brief Generateur pseudo-aleatoire xoshiro256** : un etat par flux, sans etat partage entre threads.
+ * Chaque flux est derive de (graine, numero de tournoi, numero de flux), le resultat d'un match
+ * ne depend donc ni du nombre de threads ni de l'ordre d'execution.
+*/
+typedef struct Rng{
+    uint64_t s[4];
+}Rng;
+
+/**
+ *@brief Increment de splitmix64
+*/
+#define RNG_GAMMA 0x9e3779b97f4a7c15ULL
+
+/**
+ *@brief Melange final de splitmix64 : la valeur tiree quand l'etat de splitmix64 vaut z
+*/
+static inline uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t rng_prefix(uint64_t seed, uint64_t tournament);
+void rng_seed(Rng *r, uint64_t seed, uint64_t tournament, uint64_t stream);
+
+/**
+ *@brief Rotation a gauche de k bits
+*/
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ *@brief Tire 64 bits uniformes et avance le flux
+*/
+static inline uint64_t rng_next(Rng *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+/**
+ *@brief Tire un entier uniforme dans [0, n) sans biais (methode de Lemire), remplace rand() % n
+*/
+static inline uint32_t rng_below(Rng *r, uint32_t n) {
+    uint64_t m = (rng_next(r) >> 32) * n;
+    if ((uint32_t) m < n) {
+        uint32_t threshold = -n % n;
+        while ((uint32_t) m < threshold) {
+            m = (rng_next(r) >> 32) * n;
+        }
+    }
+    return m >> 32;
+}
+
+/**
+ *@brief Tire un reel uniforme dans [0, 1) avec 53 bits de precision
+*/
+static inline double rng_uniform(Rng *r) {
+    return (rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+#endif
@@ -0,0 +1,430 @@
+#include "server.h"
+#include "bracket.h"
+#include "montecarlo.h"
+#include "analytic.h"
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ *@brief Nature d'une requete
+*/
+typedef enum RequestKind{
+    REQ_BRACKET,
+    REQ_MONTECARLO,
+    REQ_TABLE,
+    REQ_ERROR,          // requete invalide, la reponse est une erreur
+    REQ_SHUTDOWN
+}RequestKind;
+
+/**
+ *@brief Requete en cours de traitement dans un lot
+*/
+typedef struct Request{
+    RequestKind kind;
+    int fd;             // connexion a laquelle repondre
+    uint64_t seed;
+    long runs;          // nombre de tournois (MONTECARLO)
+    double start;       // reception de la requete, en secondes
+    long matches;       // nombre de matchs simules, pour le debit
+    char *body;         // contenu de la reponse, ecrit dans out
+    size_t len;
+    FILE *out;
+    Analytic analytic;  // probabilites exactes (TABLE), affichees par le thread principal
+    CachedTable *table; // table deja calculee pour cette graine (TABLE), NULL sinon
+    const char *error;  // message de REQ_ERROR
+}Request;
+
+/**
+ *@brief Mis a 1 par SIGINT ou SIGTERM pour arreter proprement le serveur
+*/
+static volatile sig_atomic_t interrupted = 0;
+
+/**
+*@brief Gestionnaire de SIGINT et SIGTERM.
+*@param sig Le signal recu.
+*@return vide.
+*/
+static void server_signal(int sig) {
+    (void) sig;
+    interrupted = 1;
+}
+
+/**
+*@brief Horloge monotone.
+*@return Le temps courant en secondes.
+*/
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+*@brief Ecrit tout un tampon sur une connexion. Un client deconnecte ne doit pas tuer le serveur : SIGPIPE n'est pas emis.
+*@param fd La connexion.
+*@param buf Les octets a ecrire.
+*@param len Le nombre d'octets.
+*@return 0, ou -1 si la connexion est perdue.
+*/
+static int send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+*@brief Simule un tournoi complet sans affichage ni donnee partagee, comme un tournoi du Monte Carlo, et l'ecrit au format de save_matchs.
+*@param r La requete.
+*@return vide.
+*/
+static void serve_bracket(Request *r) {
+    int size = bracket_size(num_teams);
+    int *perm = (int*) malloc(num_teams * sizeof(int));
+    int *alive = (int*) malloc(size * sizeof(int));
+    struct Match m;
+    int id = 0;
+
+    bracket_draw(num_teams, size, r->seed, 0, perm, alive);
+    for (int tour = 1, remaining = size; remaining > 1; tour++, remaining /= 2) {
+        for (int k = 0; k < remaining / 2; k++, id++) {
+            if (alive[2 * k + 1] < 0) {
+                alive[k] = alive[2 * k];
+                continue;
+            }
+            m.team1 = alive[2 * k];
+            m.team2 = alive[2 * k + 1];
+            m.score1 = 0;
+            m.score2 = 0;
+            m.tour = tour;
+            rng_seed(&m.rng, r->seed, 0, id);
+            alive[k] = run_match(&m, 0);
+            r->matches++;
+            fprintf(r->out, "Match %ld : %.*s [%d] : [%d] %.*s | Tour %d\n", r->matches, TEAM(m.team1), m.score1, m.score2, TEAM(m.team2), m.tour);
+        }
+    }
+    STATS_ADD(matches, r->matches);
+    free(alive);
+    free(perm);
+}
+
+/**
+*@brief Tache du pool pour une requete BRACKET ou TABLE.
+*@param arg La requete.
+*@return NULL
+*/
+static void *serve_task(void *arg) {
+    Request *r = (Request*) arg;
+
+    if (r->kind == REQ_BRACKET) {
+        serve_bracket(r);
+    } else {
+        int size = bracket_size(num_teams);
+        int *perm = (int*) malloc(num_teams * sizeof(int));
+        int *slots = (int*) malloc(size * sizeof(int));
+        bracket_draw(num_teams, size, r->seed, 0, perm, slots);
+        analytic_setup(&r->analytic, size, slots);
+        free(slots);
+        free(perm);
+    }
+    return NULL;
+}
+
+/**
+*@brief Traite un lot de requetes : tournois et tables absentes du cache sont soumis ensemble au pool, puis les reponses sont envoyees dans l'ordre avec leur latence et leur debit, chaque Monte Carlo etant reparti sur tout le pool a son tour.
+*@param s Le serveur.
+*@param reqs Les requetes du lot.
+*@param count Le nombre de requetes.
+*@return vide.
+*/
+static void server_batch(Server *s, Request *reqs, int count) {
+    for (int i = 0; i < count; i++) {
+        reqs[i].out = open_memstream(&reqs[i].body, &reqs[i].len);
+        if (reqs[i].kind == REQ_TABLE) {
+            CachedTable *t = &s->tables[reqs[i].seed % SERVER_TABLES];
+            reqs[i].table = t->body != NULL && t->seed == reqs[i].seed ? t : NULL;
+        }
+        if (reqs[i].kind == REQ_BRACKET || (reqs[i].kind == REQ_TABLE && reqs[i].table == NULL)) {
+            pool_submit(s->pool, serve_task, &reqs[i]);
+        }
+    }
+    pool_wait(s->pool);
+
+    //Reponses dans l'ordre des requetes, chaque Monte Carlo etant simule a son tour sur tout le pool
+    for (int i = 0; i < count; i++) {
+        Request *r = &reqs[i];
+        if (r->kind == REQ_MONTECARLO) {
+            MonteCarlo mc;
+            montecarlo_init(&mc, num_teams, r->runs, r->seed);
+            montecarlo_run(&mc, s->pool);
+            montecarlo_print(&mc, r->out);
+            montecarlo_free(&mc);
+            r->matches = r->runs * (num_teams - 1);
+        }
+        if (r->kind == REQ_ERROR || r->kind == REQ_SHUTDOWN) {
+            char head[32];
+            const char *msg = r->kind == REQ_ERROR ? r->error : "";
+            int n = r->kind == REQ_ERROR ? snprintf(head, sizeof(head), "ERR %zu\n", strlen(msg)) : snprintf(head, sizeof(head), "OK 0 0 0\n");
+            if (send_all(r->fd, head, n) == 0) {
+                send_all(r->fd, msg, strlen(msg));
+            }
+            fclose(r->out);
+            free(r->body);
+            continue;
+        }
+        if (r->kind == REQ_TABLE && r->table != NULL) {
+            fwrite(r->table->body, 1, r->table->len, r->out);
+        } else if (r->kind == REQ_TABLE) {
+            analytic_print(&r->analytic, r->out); // tri avec une variable statique : dans le thread principal
+            analytic_free(&r->analytic);
+        }
+        fclose(r->out);
+        if (r->kind == REQ_TABLE && r->table == NULL) { //Une seule table par case : la precedente est remplacee
+            CachedTable *t = &s->tables[r->seed % SERVER_TABLES];
+            free(t->body);
+            t->seed = r->seed;
+            t->body = (char*) malloc(r->len);
+            t->len = r->len;
+            memcpy(t->body, r->body, r->len);
+        }
+        double elapsed = now() - r->start;
+        char head[96];
+        int n = snprintf(head, sizeof(head), "OK %zu %.0f %.0f\n", r->len, elapsed * 1e6, r->matches / elapsed);
+        if (send_all(r->fd, head, n) == 0) {
+            send_all(r->fd, r->body, r->len);
+        }
+        fprintf(stderr, "requete %ld : %s graine %llu, %ld matchs en %.3f ms (%.0f matchs/s)\n", ++s->served,
+                r->kind == REQ_BRACKET ? "BRACKET" : r->kind == REQ_TABLE ? "TABLE" : "MONTECARLO",
+                (unsigned long long) r->seed, r->matches, elapsed * 1e3, r->matches / elapsed);
+        free(r->body);
+    }
+}
+
+/**
+*@brief Analyse une ligne de requete.
+*@param s Le serveur.
+*@param fd La connexion d'origine.
+*@param line La ligne, terminee par '\0' et sans fin de ligne.
+*@param r La requete a remplir.
+*@return 1 si r est une requete a traiter (erreurs comprises, pour repondre dans l'ordre), 0 pour une ligne vide, -1 pour fermer la connexion.
+*/
+static int server_parse(Server *s, int fd, char *line, Request *r) {
+    char cmd[16];
+    unsigned long long a = 0, b = 0;
+    int n = sscanf(line, "%15s %llu %llu", cmd, &a, &b);
+
+    memset(r, 0, sizeof(Request));
+    r->fd = fd;
+    r->start = now();
+    r->seed = options.seed;
+    if (n < 1) {
+        return 0; // ligne vide
+    }
+    if (strcmp(cmd, "QUIT") == 0) {
+        return -1;
+    }
+    if (strcmp(cmd, "SHUTDOWN") == 0) {
+        s->stop = 1;
+        r->kind = REQ_SHUTDOWN;
+        return 1;
+    }
+    if (strcmp(cmd, "BRACKET") == 0 || strcmp(cmd, "TABLE") == 0) {
+        r->kind = cmd[0] == 'B' ? REQ_BRACKET : REQ_TABLE;
+        if (n >= 2) {
+            r->seed = a;
+        }
+        return 1;
+    }
+    //Borne avant la multiplication : N * (equipes - 1) ne peut pas deborder
+    if (strcmp(cmd, "MONTECARLO") == 0 && n >= 2 && a > (unsigned long long) SERVER_MAX_MATCHES / (num_teams - 1)) {
+        r->kind = REQ_ERROR;
+        r->error = "MONTECARLO : trop de tournois pour une seule requete, reduire N\n";
+        return 1;
+    }
+    if (strcmp(cmd, "MONTECARLO") == 0 && n >= 2 && a > 0) {
+        r->kind = REQ_MONTECARLO;
+        r->runs = (long) a;
+        if (n >= 3) {
+            r->seed = b;
+        }
+        return 1;
+    }
+    r->kind = REQ_ERROR;
+    r->error = "requete invalide : BRACKET [S] | MONTECARLO N [S] | TABLE [S] | QUIT | SHUTDOWN\n";
+    return 1;
+}
+
+/**
+*@brief Agrandit si besoin le tableau des requetes du lot pour en ajouter une.
+*@param reqs Le tableau des requetes.
+*@param cap La capacite du tableau, mise a jour.
+*@param count Le nombre de requetes deja presentes.
+*@return Le tableau, eventuellement deplace.
+*/
+static Request *request_slot(Request *reqs, int *cap, int count) {
+    if (count == *cap) {
+        *cap = *cap ? 2 * *cap : 16;
+        reqs = (Request*) realloc(reqs, *cap * sizeof(Request));
+    }
+    return reqs;
+}
+
+/**
+*@brief Ferme la connexion d'un client et la retire de la liste.
+*@param s Le serveur.
+*@param i L'indice du client.
+*@return vide.
+*/
+static void server_drop(Server *s, int i) {
+    close(s->clients[i].fd);
+    s->clients[i] = s->clients[--s->num_clients];
+}
+
+/**
+*@brief Cree la socket Unix d'ecoute. Une socket restee d'un serveur precedent est remplacee.
+*@param s Le serveur a initialiser.
+*@param path Le chemin de la socket.
+*@param pool Le pool qui execute les requetes.
+*@return 0, ou -1 en cas d'erreur (chemin trop long, socket impossible a creer).
+*/
+int server_open(Server *s, const char *path, Pool *pool) {
+    struct sockaddr_un addr;
+
+    memset(s, 0, sizeof(Server));
+    memset(&addr, 0, sizeof(addr));
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    s->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s->fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    if (bind(s->fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(s->fd, 64) < 0) {
+        close(s->fd);
+        return -1;
+    }
+    s->path = path;
+    s->pool = pool;
+    return 0;
+}
+
+/**
+*@brief Boucle du serveur : attend avec poll de nouvelles connexions ou des requetes, puis traite en un lot toutes les requetes completes recues. S'arrete sur SHUTDOWN, SIGINT ou SIGTERM.
+*@param s Le serveur.
+*@return vide.
+*/
+void server_run(Server *s) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = server_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    struct pollfd *fds = NULL;
+    Request *reqs = NULL;
+    int reqs_cap = 0;
+
+    while (!s->stop && !interrupted) {
+        fds = (struct pollfd*) realloc(fds, (s->num_clients + 1) * sizeof(struct pollfd));
+        fds[0].fd = s->fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < s->num_clients; i++) {
+            fds[i + 1].fd = s->clients[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        int num_fds = s->num_clients + 1;
+        if (poll(fds, num_fds, -1) < 0) {
+            continue; // EINTR : interrupted est verifie au tour suivant
+        }
+
+        //Requetes des clients deja connectes, du dernier au premier pour pouvoir retirer ceux qui se sont deconnectes
+        int count = 0;
+        for (int i = num_fds - 2; i >= 0; i--) {
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            Client *c = &s->clients[i];
+            ssize_t n = read(c->fd, c->buf + c->used, SERVER_LINE - c->used);
+            if (n <= 0) {
+                server_drop(s, i);
+                continue;
+            }
+            c->used += n;
+            char *eol;
+            while (!c->quit && (eol = memchr(c->buf, '\n', c->used)) != NULL) {
+                *eol = '\0';
+                reqs = request_slot(reqs, &reqs_cap, count);
+                int kept = server_parse(s, c->fd, c->buf, &reqs[count]);
+                count += kept > 0;
+                c->quit = kept < 0;
+                c->used -= eol + 1 - c->buf;
+                memmove(c->buf, eol + 1, c->used);
+            }
+            if (!c->quit && c->used == SERVER_LINE) {
+                reqs = request_slot(reqs, &reqs_cap, count);
+                memset(&reqs[count], 0, sizeof(Request));
+                reqs[count].fd = c->fd;
+                reqs[count].kind = REQ_ERROR;
+                reqs[count++].error = "requete trop longue\n";
+                c->quit = 1;
+            }
+        }
+        if (count > 0) {
+            server_batch(s, reqs, count);
+        }
+        //Les connexions fermees par QUIT le sont apres avoir recu les reponses de leurs requetes precedentes
+        for (int i = s->num_clients - 1; i >= 0; i--) {
+            if (s->clients[i].quit) {
+                server_drop(s, i);
+            }
+        }
+
+        //Nouvelles connexions
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(s->fd, NULL, NULL);
+            if (fd >= 0) {
+                if (s->num_clients == s->cap) {
+                    s->cap = s->cap ? 2 * s->cap : 16;
+                    s->clients = (Client*) realloc(s->clients, s->cap * sizeof(Client));
+                }
+                s->clients[s->num_clients].fd = fd;
+                s->clients[s->num_clients].used = 0;
+                s->clients[s->num_clients].quit = 0;
+                s->num_clients++;
+            }
+        }
+    }
+    free(reqs);
+    free(fds);
+}
+
+/**
+*@brief Ferme toutes les connexions, supprime la socket et libere les tables gardees en memoire.
+*@param s Le serveur.
+*@return vide.
+*/
+void server_close(Server *s) {
+    while (s->num_clients > 0) {
+        server_drop(s, s->num_clients - 1);
+    }
+    for (int i = 0; i < SERVER_TABLES; i++) {
+        free(s->tables[i].body);
+    }
+    free(s->clients);
+    close(s->fd);
+    unlink(s->path);
+}
@@ -0,0 +1,71 @@
+#ifndef OS_SERVER_H
+#define OS_SERVER_H
+
+#include "fonctions.h"
+#include "pool.h"
+
+/**
+ *@brief Longueur maximale d'une requete, fin de ligne comprise
+*/
+#define SERVER_LINE 256
+
+/**
+ *@brief Nombre maximal de matchs d'une requete MONTECARLO (N * (equipes - 1)) : une requete est simulee dans la
+ * boucle du serveur, qui ne repond a aucune autre connexion pendant ce temps : la borne la limite a environ
+ * deux secondes avec le moteur minute sur un seul coeur. Au-dela, la reponse est une erreur.
+*/
+#define SERVER_MAX_MATCHES 1000000L
+
+/**
+ *@brief Nombre de tables (TABLE) gardees en memoire, une par graine : les equipes etant chargees une seule fois,
+ * une table deja calculee est renvoyee telle quelle
+*/
+#define SERVER_TABLES 16
+
+/**
+ *@brief Connexion d'un client, avec les octets recus qui ne forment pas encore une ligne complete
+*/
+typedef struct Client{
+    int fd;
+    char buf[SERVER_LINE];
+    size_t used;
+    int quit;           // QUIT recu ou requete invalide : fermee apres le lot en cours
+}Client;
+
+/**
+ *@brief Table des probabilites exactes deja mise en forme pour une graine
+*/
+typedef struct CachedTable{
+    uint64_t seed;
+    char *body;         // NULL si l'entree est libre
+    size_t len;
+}CachedTable;
+
+/**
+ *@brief Serveur de simulation (--serve) : les equipes sont chargees une seule fois, puis le serveur ecoute sur une socket Unix.
+ * Une requete est une ligne de texte :
+ *   BRACKET [S]       un tournoi complet tire avec la graine S, au format de matchs.txt
+ *   MONTECARLO N [S]  la table des probabilites de N tournois Monte Carlo (au plus SERVER_MAX_MATCHES matchs)
+ *   TABLE [S]         la table des probabilites exactes du tableau tire avec la graine S (voir analytic.h)
+ *   QUIT              ferme la connexion apres les reponses en attente ; SHUTDOWN arrete le serveur
+ * La graine par defaut est celle de --seed. Chaque reponse est une ligne "OK <octets> <latence_us> <matchs_par_s>"
+ * ou "ERR <octets>", suivie d'exactement <octets> octets de contenu. Toutes les requetes recues pendant un meme reveil de
+ * poll forment un lot : les tournois et les tables sont soumis ensemble au pool, chaque Monte Carlo utilise tout le pool.
+*/
+typedef struct Server{
+    int fd;             // socket d'ecoute
+    const char *path;   // chemin de la socket, supprime a la fermeture
+    Pool *pool;         // pool partage par toutes les requetes
+    Client *clients;    // connexions ouvertes
+    int num_clients;
+    int cap;
+    int stop;           // SHUTDOWN recu
+    long served;        // nombre de requetes traitees
+    CachedTable tables[SERVER_TABLES]; // tables deja calculees, rangees selon leur graine
+}Server;
+
+int server_open(Server *s, const char *path, Pool *pool);
+void server_run(Server *s);
+void server_close(Server *s);
+
+#endif
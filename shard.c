@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include "shard.h"
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+
+/**
+ *@brief Segment partage entre le pere et les shards : un drapeau de fin par shard, puis les compteurs de chaque shard
+*/
+typedef struct ShardSegment{
+    void *base;             // projection du segment
+    size_t bytes;           // taille du segment
+    atomic_int *done;       // 1 quand le shard a ecrit tous ses compteurs
+    long *reached;          // shards * cells compteurs, comme MonteCarlo.reached
+    size_t cells;           // compteurs par shard
+#ifdef WITH_STATS
+    StatsCounters *stats;   // compteurs --stats de chaque shard, fusionnes par stats_collect
+    int *threads;           // nombre de threads mesures dans chaque shard
+#endif
+}ShardSegment;
+
+/**
+*@brief Lit une liste de processeurs au format du noyau ("0-3,8,10-11") dans un ensemble.
+*@param list La liste.
+*@param set L'ensemble a remplir.
+*@return Le nombre de processeurs lus.
+*/
+static int parse_cpulist(const char *list, cpu_set_t *set) {
+    int count = 0;
+    CPU_ZERO(set);
+    while (*list != '\0' && *list != '\n') {
+        char *end;
+        long lo = strtol(list, &end, 10);
+        long hi = lo;
+        if (end == list) {
+            break;
+        }
+        if (*end == '-') {
+            list = end + 1;
+            hi = strtol(list, &end, 10);
+        }
+        for (long c = lo; c <= hi && c < CPU_SETSIZE; c++) {
+            CPU_SET(c, set);
+            count++;
+        }
+        list = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+/**
+*@brief Epingle le processus courant : sur le noeud NUMA shard % noeuds s'il y a plusieurs noeuds, sinon sur la part shard des processeurs autorises (un processeur par shard s'il y a plus de shards que de processeurs).
+*@param shard Le numero du shard.
+*@param shards Le nombre de shards.
+*@return vide.
+*/
+static void shard_pin(int shard, int shards) {
+    char path[64];
+    char list[4096];
+    cpu_set_t set;
+    int nodes = 0;
+
+    while (snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes), access(path, R_OK) == 0) {
+        nodes++;
+    }
+    if (nodes > 1) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", shard % nodes);
+        FILE *fp = fopen(path, "r");
+        if (fp != NULL && fgets(list, sizeof(list), fp) != NULL && parse_cpulist(list, &set) > 0) {
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+        if (fp != NULL) {
+            fclose(fp);
+        }
+        return;
+    }
+
+    cpu_set_t allowed;
+    int cpus[CPU_SETSIZE];
+    int n = 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        return;
+    }
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &allowed)) {
+            cpus[n++] = c;
+        }
+    }
+    if (n == 0) {
+        return;
+    }
+    CPU_ZERO(&set);
+    if (n >= shards) {
+        for (int i = (long) shard * n / shards; i < (long) (shard + 1) * n / shards; i++) {
+            CPU_SET(cpus[i], &set);
+        }
+    } else {
+        CPU_SET(cpus[shard % n], &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+/**
+*@brief Tranche de tournois du shard : les runs tournois sont repartis en shards tranches contigues.
+*@param mc La simulation complete.
+*@param shard Le numero du shard.
+*@param shards Le nombre de shards.
+*@param first Recoit le premier tournoi de la tranche.
+*@return Le nombre de tournois de la tranche.
+*/
+static long shard_slice(MonteCarlo *mc, int shard, int shards, long *first) {
+    *first = mc->runs * shard / shards;
+    return mc->runs * (shard + 1) / shards - *first;
+}
+
+/**
+*@brief Corps d'un processus shard : simule sa tranche sur son propre pool, copie ses compteurs (et ses statistiques avec --stats) dans le segment, marque la tranche terminee puis quitte sans repasser par le code du pere.
+*@param mc La simulation complete.
+*@param seg Le segment partage.
+*@param shard Le numero du shard.
+*@param shards Le nombre de shards.
+*@param threads Le nombre de workers du pool du shard.
+*@return Ne retourne pas.
+*/
+static void shard_child(MonteCarlo *mc, ShardSegment *seg, int shard, int shards, int threads) {
+    MonteCarlo slice;
+    Pool pool;
+    long first;
+    long runs = shard_slice(mc, shard, shards, &first);
+
+#ifdef WITH_STATS
+    if (stats_enabled) {
+        stats_reset();
+    }
+#endif
+    shard_pin(shard, shards);
+    montecarlo_init(&slice, mc->num_teams, runs, mc->seed);
+    slice.first = first;
+    if (runs > 0) {
+        pool_init(&pool, threads);
+        montecarlo_run(&slice, &pool);
+        pool_destroy(&pool);
+    }
+    memcpy(&seg->reached[shard * seg->cells], slice.reached, seg->cells * sizeof(long));
+#ifdef WITH_STATS
+    if (stats_enabled) {
+        seg->threads[shard] = stats_collect(&seg->stats[shard]);
+    }
+#endif
+    montecarlo_free(&slice);
+    atomic_store(&seg->done[shard], 1);
+    _exit(EXIT_SUCCESS);
+}
+
+/**
+*@brief Lance (ou relance) un shard dans un processus fils, apres avoir remis sa zone a zero.
+*@param mc La simulation complete.
+*@param seg Le segment partage.
+*@param shard Le numero du shard.
+*@param shards Le nombre de shards.
+*@param threads Le nombre de workers du pool du shard.
+*@return Le pid du fils, ou -1 si fork a echoue.
+*/
+static pid_t shard_spawn(MonteCarlo *mc, ShardSegment *seg, int shard, int shards, int threads) {
+    atomic_store(&seg->done[shard], 0);
+    memset(&seg->reached[shard * seg->cells], 0, seg->cells * sizeof(long));
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        shard_child(mc, seg, shard, shards, threads);
+    }
+    return pid;
+}
+
+/**
+*@brief Simule mc->runs tournois Monte Carlo dans shards processus, fusionne leurs compteurs dans mc->reached et relance les shards interrompus (au plus SHARD_RETRIES fois chacun).
+*@param mc La simulation, preparee par montecarlo_init.
+*@param shards Le nombre de processus.
+*@param threads Le nombre total de workers, partage entre les shards (au moins un par shard).
+*@return 0, ou -1 si le segment partage n'a pas pu etre cree ou si un shard a echoue trop de fois.
+*/
+int shard_run(MonteCarlo *mc, int shards, int threads) {
+    ShardSegment seg;
+    char name[64];
+    int per_shard = threads / shards > 0 ? threads / shards : 1;
+    int status = 0;
+
+    //Segment POSIX nomme d'apres le pid, supprime des qu'il est projete : rien ne reste si le pere meurt
+    seg.cells = (size_t) mc->num_teams * (mc->num_rounds + 1);
+    size_t header = (shards * sizeof(atomic_int) + 63) / 64 * 64;
+    seg.bytes = header + shards * seg.cells * sizeof(long);
+#ifdef WITH_STATS
+    size_t stats = (seg.bytes + 63) / 64 * 64;
+    seg.bytes = stats + shards * (sizeof(StatsCounters) + sizeof(int));
+#endif
+    snprintf(name, sizeof(name), "/match_simulator-%d", (int) getpid());
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    shm_unlink(name);
+    if (ftruncate(fd, seg.bytes) < 0) {
+        close(fd);
+        return -1;
+    }
+    seg.base = mmap(NULL, seg.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg.base == MAP_FAILED) {
+        return -1;
+    }
+    seg.done = (atomic_int*) seg.base;
+    seg.reached = (long*) ((char*) seg.base + header);
+#ifdef WITH_STATS
+    seg.stats = (StatsCounters*) ((char*) seg.base + stats);
+    seg.threads = (int*) (seg.stats + shards);
+#endif
+
+    pid_t *pids = (pid_t*) malloc(shards * sizeof(pid_t));
+    int *retries = (int*) calloc(shards, sizeof(int));
+    int running = 0;
+    for (int s = 0; s < shards; s++) {
+        pids[s] = shard_spawn(mc, &seg, s, shards, per_shard);
+        running += pids[s] > 0;
+        if (pids[s] < 0) {
+            status = -1;
+        }
+    }
+
+    //Attente des shards : un shard mort par un signal, en erreur ou sans avoir marque sa tranche est relance
+    while (running > 0) {
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        int s = 0;
+        while (s < shards && pids[s] != pid) {
+            s++;
+        }
+        if (s == shards) {
+            continue;
+        }
+        running--;
+        pids[s] = 0;
+        if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0 && atomic_load(&seg.done[s])) {
+            continue;
+        }
+        long first;
+        long runs = shard_slice(mc, s, shards, &first);
+        if (WIFSIGNALED(wstatus)) {
+            fprintf(stderr, "Shard %d (tournois %ld a %ld) interrompu par le signal %d", s, first, first + runs - 1, WTERMSIG(wstatus));
+        } else {
+            fprintf(stderr, "Shard %d (tournois %ld a %ld) termine en erreur", s, first, first + runs - 1);
+        }
+        if (retries[s] == SHARD_RETRIES) {
+            fprintf(stderr, ", abandon apres %d relances\n", SHARD_RETRIES);
+            status = -1;
+            continue;
+        }
+        retries[s]++;
+        fprintf(stderr, ", relance %d/%d\n", retries[s], SHARD_RETRIES);
+        pids[s] = shard_spawn(mc, &seg, s, shards, per_shard);
+        if (pids[s] > 0) {
+            running++;
+        } else {
+            status = -1;
+        }
+    }
+
+    //Fusion des compteurs des shards, dans l'ordre des shards
+    if (status == 0) {
+        memset(mc->reached, 0, seg.cells * sizeof(long));
+        for (int s = 0; s < shards; s++) {
+            for (size_t j = 0; j < seg.cells; j++) {
+                mc->reached[j] += seg.reached[s * seg.cells + j];
+            }
+#ifdef WITH_STATS
+            if (stats_enabled) {
+                stats_merge(&seg.stats[s], seg.threads[s]);
+            }
+#endif
+        }
+    }
+    free(retries);
+    free(pids);
+    munmap(seg.base, seg.bytes);
+    return status;
+}
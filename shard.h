@@ -0,0 +1,20 @@
+#ifndef OS_SHARD_H
+#define OS_SHARD_H
+
+#include "montecarlo.h"
+
+/**
+ *@brief Nombre de relances d'un shard interrompu avant d'abandonner la simulation
+*/
+#define SHARD_RETRIES 3
+
+/**
+ *@brief Monte Carlo multi-processus (--shards K) : K processus fils simulent chacun une tranche contigue des tournois,
+ * avec son propre pool, epingles sur un noeud NUMA (ou, sur une machine a un seul noeud, sur une part des coeurs autorises).
+ * Chaque fils ecrit ses compteurs dans sa propre zone d'un segment de memoire partagee POSIX, puis marque sa tranche terminee ;
+ * le processus pere additionne les zones a la fin. Un fils qui meurt ou echoue est detecte par waitpid et relance
+ * sur la meme tranche : les tournois ne dependant que de (graine, numero), le resultat est identique a une execution sans shards.
+*/
+int shard_run(MonteCarlo *mc, int shards, int threads);
+
+#endif
@@ -0,0 +1,267 @@
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#ifdef WITH_STATS
+
+/**
+ *@brief 1 si --stats est demande
+*/
+int stats_enabled = 0;
+
+/**
+ *@brief Destination du JSON (--stats=FICHIER), NULL pour la sortie d'erreur
+*/
+static const char *stats_path;
+
+/**
+ *@brief Duree cumulee de chaque phase, mise a jour par le thread principal
+*/
+static uint64_t phases[STATS_PHASES];
+
+/**
+ *@brief Liste des compteurs de tous les threads, protegee par list_lock
+*/
+static StatsCounters *all;
+static pthread_mutex_t list_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ *@brief Threads des processus fils (--shards) dont les compteurs ont ete fusionnes par stats_merge, au-dela du premier
+*/
+static int merged_threads;
+
+/**
+ *@brief Compteurs du thread courant, crees a sa premiere mesure
+*/
+static __thread StatsCounters *local;
+
+/**
+*@brief Horloge monotone.
+*@return Le temps courant en nanosecondes.
+*/
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+*@brief Compteurs du thread courant ; ils sont crees et ajoutes a la liste commune au premier appel, et survivent au thread jusqu'a stats_dump.
+*@return Les compteurs du thread.
+*/
+StatsCounters *stats_local(void) {
+    if (local == NULL) {
+        local = (StatsCounters*) calloc(1, sizeof(StatsCounters));
+        pthread_mutex_lock(&list_lock);
+        local->next = all;
+        all = local;
+        pthread_mutex_unlock(&list_lock);
+    }
+    return local;
+}
+
+/**
+*@brief Ajoute la duree ecoulee depuis start a une phase.
+*@param phase La phase.
+*@param start Le debut de la mesure (STATS_START).
+*@return vide.
+*/
+void stats_phase(StatsPhase phase, uint64_t start) {
+    phases[phase] += stats_now() - start;
+}
+
+/**
+*@brief Enregistre un match du tour tour, commence a start et termine maintenant.
+*@param tour Le tour du match.
+*@param start Le debut du match (STATS_START).
+*@return vide.
+*/
+void stats_round(int tour, uint64_t start) {
+    StatsCounters *c = stats_local();
+    uint64_t end = stats_now();
+    int r = tour < STATS_MAX_ROUNDS ? tour : STATS_MAX_ROUNDS - 1;
+
+    c->matches++;
+    if (c->round_matches[r]++ == 0 || start < c->round_first[r]) {
+        c->round_first[r] = start;
+    }
+    if (end > c->round_last[r]) {
+        c->round_last[r] = end;
+    }
+}
+
+/**
+*@brief Verrouille un mutex en mesurant la contention : un essai sans attente, puis un verrouillage bloquant chronometre si le mutex etait pris.
+*@param m Le mutex.
+*@return Le resultat de pthread_mutex_lock.
+*/
+int stats_lock(pthread_mutex_t *m) {
+    if (!stats_enabled) {
+        return pthread_mutex_lock(m);
+    }
+    StatsCounters *c = stats_local();
+    c->acquisitions++;
+    if (pthread_mutex_trylock(m) == 0) {
+        return 0;
+    }
+    uint64_t start = stats_now();
+    int err = pthread_mutex_lock(m);
+    c->contended++;
+    c->wait_ns += stats_now() - start;
+    return err;
+}
+
+/**
+*@brief Active la collecte des statistiques.
+*@param path Le fichier de destination du JSON, NULL pour la sortie d'erreur.
+*@return 0.
+*/
+int stats_enable(const char *path) {
+    stats_enabled = 1;
+    stats_path = path;
+    return 0;
+}
+
+/**
+*@brief Oublie les compteurs herites du pere, dans un processus fils juste apres fork : le fils ne compte ensuite que ses propres threads. Le verrou de la liste est recree, un autre thread du pere ayant pu le tenir au moment du fork.
+*@return vide.
+*/
+void stats_reset(void) {
+    while (all != NULL) {
+        StatsCounters *next = all->next;
+        free(all);
+        all = next;
+    }
+    local = NULL;
+    merged_threads = 0;
+    pthread_mutex_init(&list_lock, NULL);
+}
+
+/**
+*@brief Fusionne les compteurs de tous les threads : les totaux sont additionnes, les bornes de chaque tour sont la premiere et la derniere mesure de tous les threads.
+*@param sum Les compteurs fusionnes (next n'est pas rempli).
+*@return Le nombre de threads mesures.
+*/
+int stats_collect(StatsCounters *sum) {
+    int threads = merged_threads;
+
+    memset(sum, 0, sizeof(StatsCounters));
+    pthread_mutex_lock(&list_lock);
+    for (StatsCounters *c = all; c != NULL; c = c->next) {
+        threads++;
+        sum->matches += c->matches;
+        sum->events += c->events;
+        sum->acquisitions += c->acquisitions;
+        sum->contended += c->contended;
+        sum->wait_ns += c->wait_ns;
+        for (int r = 0; r < STATS_MAX_ROUNDS; r++) {
+            if (c->round_matches[r] == 0) {
+                continue;
+            }
+            if (sum->round_matches[r] == 0 || c->round_first[r] < sum->round_first[r]) {
+                sum->round_first[r] = c->round_first[r];
+            }
+            if (c->round_last[r] > sum->round_last[r]) {
+                sum->round_last[r] = c->round_last[r];
+            }
+            sum->round_matches[r] += c->round_matches[r];
+        }
+    }
+    pthread_mutex_unlock(&list_lock);
+    return threads;
+}
+
+/**
+*@brief Ajoute les compteurs fusionnes d'un processus fils (--shards) a ceux du processus courant : ils seront comptes par stats_dump. L'horloge monotone etant commune a tous les processus, les bornes des tours restent comparables.
+*@param c Les compteurs du fils, tels que rendus par stats_collect.
+*@param threads Le nombre de threads mesures dans le fils.
+*@return vide.
+*/
+void stats_merge(const StatsCounters *c, int threads) {
+    StatsCounters *copy = (StatsCounters*) malloc(sizeof(StatsCounters));
+
+    memcpy(copy, c, sizeof(StatsCounters));
+    pthread_mutex_lock(&list_lock);
+    copy->next = all;
+    all = copy;
+    merged_threads += threads > 0 ? threads - 1 : -1;
+    pthread_mutex_unlock(&list_lock);
+}
+
+/**
+*@brief Fusionne les compteurs de tous les threads, ecrit le JSON et libere les compteurs. Les threads mesures doivent avoir termine. Le pic de memoire est celui du processus ou, s'il est plus grand, celui du plus gros processus fils (--shards).
+*@return vide.
+*/
+void stats_dump(void) {
+    static const char *names[STATS_PHASES] = {"load", "shuffle", "spawn", "run", "join", "save"};
+    StatsCounters sum;
+
+    if (!stats_enabled) {
+        return;
+    }
+    int threads = stats_collect(&sum);
+
+    FILE *out = stats_path != NULL ? fopen(stats_path, "w") : stderr;
+    if (out == NULL) {
+        printf("Erreur lors de l'ouverture du fichier %s.\n", stats_path);
+        out = stderr;
+    }
+    fprintf(out, "{\n  \"phases_ms\": {");
+    for (int p = 0; p < STATS_PHASES; p++) {
+        fprintf(out, "%s\"%s\": %.3f", p > 0 ? ", " : "", names[p], phases[p] / 1e6);
+    }
+    fprintf(out, "},\n  \"rounds\": [");
+    int first = 1;
+    for (int r = 0; r < STATS_MAX_ROUNDS; r++) {
+        if (sum.round_matches[r] > 0) {
+            fprintf(out, "%s\n    {\"tour\": %d, \"matches\": %llu, \"wall_ms\": %.3f}", first ? "" : ",", r,
+                    (unsigned long long) sum.round_matches[r], (sum.round_last[r] - sum.round_first[r]) / 1e6);
+            first = 0;
+        }
+    }
+    fprintf(out, "%s],\n", first ? "" : "\n  ");
+    fprintf(out, "  \"mutex\": {\"acquisitions\": %llu, \"contended\": %llu, \"wait_ms\": %.3f},\n",
+            (unsigned long long) sum.acquisitions, (unsigned long long) sum.contended, sum.wait_ns / 1e6);
+    struct rusage ru, children;
+    getrusage(RUSAGE_SELF, &ru);
+    getrusage(RUSAGE_CHILDREN, &children);
+    if (children.ru_maxrss > ru.ru_maxrss) {
+        ru.ru_maxrss = children.ru_maxrss;
+    }
+    fprintf(out, "  \"matches\": %llu,\n  \"events\": %llu,\n  \"threads\": %d,\n  \"peak_rss_kb\": %ld\n}\n",
+            (unsigned long long) sum.matches, (unsigned long long) sum.events, threads, ru.ru_maxrss);
+    if (out != stderr) {
+        fclose(out);
+    }
+
+    while (all != NULL) {
+        StatsCounters *next = all->next;
+        free(all);
+        all = next;
+    }
+    local = NULL;
+    merged_threads = 0;
+}
+
+#else
+
+/**
+*@brief Sans WITH_STATS, --stats est refuse.
+*@param path Ignore.
+*@return -1.
+*/
+int stats_enable(const char *path) {
+    (void) path;
+    return -1;
+}
+
+/**
+*@brief Sans WITH_STATS, rien a ecrire.
+*@return vide.
+*/
+void stats_dump(void) {
+}
+
+#endif
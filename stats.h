@@ -0,0 +1,80 @@
+#ifndef OS_STATS_H
+#define OS_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ *@brief Instrumentation du simulateur, activee par --stats.
+ * Chaque thread compte dans ses propres compteurs (aucune ecriture partagee sur le chemin chaud), qui sont
+ * fusionnes a la fin par stats_dump. Les macros STATS_* sont les seuls points d'entree : compile sans
+ * WITH_STATS (make STATS=0), le module disparait entierement et STATS_LOCK redevient pthread_mutex_lock.
+*/
+
+/**
+ *@brief Nombre maximal de tours suivis (un tableau de 2^31 equipes en a 31)
+*/
+#define STATS_MAX_ROUNDS 32
+
+/**
+ *@brief Phases chronometrees par le thread principal
+*/
+typedef enum StatsPhase{
+    STATS_LOAD,     // projection et decoupage du fichier des equipes
+    STATS_SHUFFLE,  // melange des equipes
+    STATS_SPAWN,    // creation des threads (pool et journal)
+    STATS_RUN,      // simulation, du premier match a la fin du tournoi
+    STATS_JOIN,     // arret et attente des threads
+    STATS_SAVE,     // ecriture des resultats
+    STATS_PHASES
+}StatsPhase;
+
+#ifdef WITH_STATS
+
+/**
+ *@brief Compteurs propres a un thread
+*/
+typedef struct StatsCounters{
+    uint64_t matches;           // matchs simules
+    uint64_t events;            // lignes d'evenements ecrites par le journal
+    uint64_t acquisitions;      // verrouillages du mutex global
+    uint64_t contended;         // verrouillages ou le mutex etait deja pris
+    uint64_t wait_ns;           // attente cumulee du mutex global
+    uint64_t round_matches[STATS_MAX_ROUNDS];
+    uint64_t round_first[STATS_MAX_ROUNDS]; // debut du premier match du tour vu par ce thread
+    uint64_t round_last[STATS_MAX_ROUNDS];  // fin du dernier match du tour vu par ce thread
+    struct StatsCounters *next; // liste de tous les compteurs, pour la fusion
+}StatsCounters;
+
+extern int stats_enabled;
+
+uint64_t stats_now(void);
+StatsCounters *stats_local(void);
+void stats_phase(StatsPhase phase, uint64_t start);
+void stats_round(int tour, uint64_t start);
+int stats_lock(pthread_mutex_t *m);
+void stats_reset(void);
+int stats_collect(StatsCounters *sum);
+void stats_merge(const StatsCounters *c, int threads);
+
+#define STATS_START(var) uint64_t var = stats_enabled ? stats_now() : 0
+#define STATS_PHASE(phase, start) do { if (stats_enabled) stats_phase((phase), (start)); } while (0)
+#define STATS_ROUND(tour, start) do { if (stats_enabled) stats_round((tour), (start)); } while (0)
+#define STATS_ADD(field, n) do { if (stats_enabled) stats_local()->field += (n); } while (0)
+#define STATS_LOCK(m) stats_lock(m)
+
+#else
+
+#define STATS_START(var) do { } while (0)
+#define STATS_PHASE(phase, start) do { } while (0)
+#define STATS_ROUND(tour, start) do { } while (0)
+#define STATS_ADD(field, n) do { } while (0)
+#define STATS_LOCK(m) pthread_mutex_lock(m)
+
+#endif
+
+int stats_enable(const char *path);
+void stats_dump(void);
+
+#endif
@@ -0,0 +1,306 @@
+#include "table.h"
+
+/**
+ *@brief Probabilite en dessous de laquelle une issue est ignoree
+*/
+#define TABLE_EPSILON 1e-15
+
+/**
+ *@brief Tables du moteur --engine table, construites au demarrage par table_build
+*/
+OutcomeTable outcomes;
+
+/**
+*@brief Construit une table d'alias (methode de Vose) a partir d'une distribution.
+*@param a La table a remplir.
+*@param prob Les probabilites des issues, de somme 1 ; le tableau est modifie.
+*@param outcome Les issues codees.
+*@param n Le nombre d'issues.
+*@return vide.
+*/
+static void alias_build(AliasTable *a, double *prob, const uint32_t *outcome, int n) {
+    int *small = (int*) malloc(n * sizeof(int));
+    int *large = (int*) malloc(n * sizeof(int));
+    int ns = 0, nl = 0;
+
+    a->count = n;
+    a->threshold = (uint32_t*) malloc(n * sizeof(uint32_t));
+    a->alias = (uint32_t*) malloc(n * sizeof(uint32_t));
+    a->outcome = (uint32_t*) malloc(n * sizeof(uint32_t));
+    memcpy(a->outcome, outcome, n * sizeof(uint32_t));
+    for (int i = 0; i < n; i++) {
+        prob[i] *= n;
+        if (prob[i] < 1.0) {
+            small[ns++] = i;
+        } else {
+            large[nl++] = i;
+        }
+    }
+    while (ns > 0 && nl > 0) {
+        int s = small[--ns];
+        int l = large[nl - 1];
+        a->threshold[s] = (uint32_t) (prob[s] * 4294967296.0);
+        a->alias[s] = l;
+        prob[l] -= 1.0 - prob[s];
+        if (prob[l] < 1.0) {
+            nl--;
+            small[ns++] = l;
+        }
+    }
+    //Restes (a 1 aux arrondis pres) : la case est toujours gardee
+    while (nl > 0) {
+        int l = large[--nl];
+        a->threshold[l] = UINT32_MAX;
+        a->alias[l] = l;
+    }
+    while (ns > 0) {
+        int s = small[--ns];
+        a->threshold[s] = UINT32_MAX;
+        a->alias[s] = s;
+    }
+    free(large);
+    free(small);
+}
+
+/**
+*@brief Tire une issue dans une table d'alias avec le flux du match.
+*@param a La table.
+*@param rng Le flux aleatoire.
+*@return L'issue codee (score1 << 16) | score2.
+*/
+static inline uint32_t alias_draw(const AliasTable *a, Rng *rng) {
+    uint64_t x = rng_next(rng);
+    uint32_t i = (uint32_t) (((x >> 32) * (uint64_t) a->count) >> 32);
+    return (uint32_t) x < a->threshold[i] ? a->outcome[i] : a->outcome[a->alias[i]];
+}
+
+/**
+*@brief Score maximal retenu pour une equipe sur le temps reglementaire : moyenne des buts du match plus 12 ecarts-types, ce qui laisse une probabilite negligeable au-dela.
+*@param odds Les chances du match.
+*@return Le score maximal, au plus match_duration.
+*/
+static int regulation_cap(const Odds *odds) {
+    double mean = match_duration * (odds->goal1 + odds->goal2) / 10000.0;
+    int cap = (int) ceil(mean + 12 * sqrt(mean) + 12);
+    return cap < match_duration ? cap : match_duration;
+}
+
+/**
+*@brief Distribution du score du temps reglementaire : chaque minute donne un but a l'equipe 1, a l'equipe 2, ou aucun, d'ou une loi multinomiale.
+*@param odds Les chances du match.
+*@param prob Recoit le tableau alloue des probabilites des issues, de somme 1.
+*@param outcome Recoit le tableau alloue des issues codees (score1 << 16) | score2.
+*@return Le nombre d'issues.
+*/
+static int regulation_distribution(const Odds *odds, double **prob_out, uint32_t **outcome_out) {
+    int n = match_duration > 0 ? match_duration : 0;
+    int cap = n > 0 ? regulation_cap(odds) : 0;
+    double l1 = log(odds->goal1 / 10000.0);
+    double l2 = log(odds->goal2 / 10000.0);
+    double l0 = log(1.0 - (odds->goal1 + odds->goal2) / 10000.0);
+    double *prob = (double*) malloc((size_t) (cap + 1) * (cap + 1) * sizeof(double));
+    uint32_t *outcome = (uint32_t*) malloc((size_t) (cap + 1) * (cap + 1) * sizeof(uint32_t));
+    double total = 0;
+    int count = 0;
+
+    for (int s1 = 0; s1 <= cap; s1++) {
+        for (int s2 = 0; s2 <= cap && s1 + s2 <= n; s2++) {
+            double p = exp(lgamma(n + 1) - lgamma(s1 + 1) - lgamma(s2 + 1) - lgamma(n - s1 - s2 + 1)
+                           + (s1 ? s1 * l1 : 0) + (s2 ? s2 * l2 : 0) + (n - s1 - s2 ? (n - s1 - s2) * l0 : 0));
+            if (p > TABLE_EPSILON) {
+                prob[count] = p;
+                outcome[count++] = (uint32_t) s1 << 16 | s2;
+                total += p;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        prob[i] /= total;
+    }
+    *prob_out = prob;
+    *outcome_out = outcome;
+    return count;
+}
+
+/**
+*@brief Probabilite binomiale P(X = k) pour X ~ B(n, q).
+*@return La probabilite.
+*/
+static double binomial(int n, int k, double q) {
+    double c = 1;
+    for (int i = 0; i < k; i++) {
+        c = c * (n - i) / (i + 1);
+    }
+    return c * pow(q, k) * pow(1 - q, n - k);
+}
+
+/**
+*@brief Distribution des buts d'une seance de tirs au but, comme penalty_shootout : 5 tirs par equipe, puis un tir chacun tant que l'egalite persiste.
+* Apres une egalite a d, la mort subite finit en (d + s + 1, d + s) ou (d + s, d + s + 1) apres s tours reussis des deux cotes ; les tours manques des deux cotes ne changent pas le score, d'ou le facteur 1 / (1 - q0)^(s+1).
+*@param odds Les chances du match.
+*@param prob Recoit le tableau alloue des probabilites des issues, de somme 1.
+*@param outcome Recoit le tableau alloue des issues codees (buts de l'equipe 1 << 16) | buts de l'equipe 2.
+*@return Le nombre d'issues.
+*/
+static int penalty_distribution(const Odds *odds, double **prob_out, uint32_t **outcome_out) {
+    enum {MAX_OUTCOMES = 36 + 6 * 2 * 512};
+    double q1 = odds->pen1 / 10000.0;
+    double q2 = odds->pen2 / 10000.0;
+    double both = q1 * q2;                  // les deux marquent : on continue
+    double none = (1 - q1) * (1 - q2);      // les deux manquent : on continue
+    double *prob = (double*) malloc(MAX_OUTCOMES * sizeof(double));
+    uint32_t *outcome = (uint32_t*) malloc(MAX_OUTCOMES * sizeof(uint32_t));
+    double total = 0;
+    int count = 0;
+
+    for (int d1 = 0; d1 <= 5; d1++) {
+        for (int d2 = 0; d2 <= 5; d2++) {
+            double p = binomial(5, d1, q1) * binomial(5, d2, q2);
+            if (d1 != d2) {
+                prob[count] = p;
+                outcome[count++] = (uint32_t) d1 << 16 | d2;
+                total += p;
+                continue;
+            }
+            //Mort subite apres une egalite a d1
+            double run = p / (1 - none);
+            for (int s = 0; s < 512 && run > TABLE_EPSILON; s++) {
+                prob[count] = run * q1 * (1 - q2);
+                outcome[count++] = (uint32_t) (d1 + s + 1) << 16 | (d1 + s);
+                prob[count] = run * q2 * (1 - q1);
+                outcome[count++] = (uint32_t) (d1 + s) << 16 | (d1 + s + 1);
+                total += prob[count - 2] + prob[count - 1];
+                run *= both / (1 - none);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        prob[i] /= total;
+    }
+    *prob_out = prob;
+    *outcome_out = outcome;
+    return count;
+}
+
+/**
+*@brief Probabilite exacte que l'equipe 1 gagne un match : victoire au temps reglementaire, ou egalite puis victoire aux tirs au but.
+*@param odds Les chances du match.
+*@return La probabilite de victoire de l'equipe 1.
+*/
+double table_win_probability(const Odds *odds) {
+    double *prob;
+    uint32_t *outcome;
+    double win = 0, draw = 0, shootout = 0;
+
+    int count = regulation_distribution(odds, &prob, &outcome);
+    for (int i = 0; i < count; i++) {
+        int s1 = outcome[i] >> 16, s2 = outcome[i] & 0xffff;
+        win += s1 > s2 ? prob[i] : 0;
+        draw += s1 == s2 ? prob[i] : 0;
+    }
+    free(outcome);
+    free(prob);
+    count = penalty_distribution(odds, &prob, &outcome);
+    for (int i = 0; i < count; i++) {
+        shootout += (outcome[i] >> 16) > (outcome[i] & 0xffff) ? prob[i] : 0;
+    }
+    free(outcome);
+    free(prob);
+    return win + draw * shootout;
+}
+
+/**
+*@brief Precalcule les distributions de resultats pour tous les ecarts de classement possibles entre les equipes chargees.
+*@param t Les tables a construire.
+*@return 0, ou -1 si les tables depasseraient TABLE_MAX_OUTCOMES issues (rien n'est alloue).
+*/
+int table_build(OutcomeTable *t) {
+    int spread = 0;
+    if (teams.ratings != NULL) {
+        double lo = teams.ratings[0], hi = teams.ratings[0];
+        for (int i = 1; i < num_teams; i++) {
+            lo = teams.ratings[i] < lo ? teams.ratings[i] : lo;
+            hi = teams.ratings[i] > hi ? teams.ratings[i] : hi;
+        }
+        double range = ceil(hi - lo);
+        spread = range < RATING_MAX_DIFF ? (int) range : RATING_MAX_DIFF;
+    }
+    t->min_diff = -spread;
+    t->max_diff = spread;
+    int num = 2 * spread + 1;
+
+    //Estimation de la taille avant de construire : (cap + 1)^2 issues au plus par table
+    Odds odds;
+    odds_from_diff(spread, &odds);
+    long cap = match_duration > 0 ? regulation_cap(&odds) : 0;
+    if ((double) num * (cap + 1) * (cap + 1) > TABLE_MAX_OUTCOMES) {
+        return -1;
+    }
+
+    t->regulation = (AliasTable*) malloc(num * sizeof(AliasTable));
+    t->penalties = (AliasTable*) malloc(num * sizeof(AliasTable));
+    for (int d = t->min_diff; d <= t->max_diff; d++) {
+        double *prob;
+        uint32_t *outcome;
+        odds_from_diff(d, &odds);
+        int count = regulation_distribution(&odds, &prob, &outcome);
+        alias_build(&t->regulation[d - t->min_diff], prob, outcome, count);
+        free(outcome);
+        free(prob);
+        count = penalty_distribution(&odds, &prob, &outcome);
+        alias_build(&t->penalties[d - t->min_diff], prob, outcome, count);
+        free(outcome);
+        free(prob);
+    }
+    return 0;
+}
+
+/**
+*@brief Tire en O(1) le score du temps reglementaire seul, dans la table de l'ecart de classement : le match peut rester nul.
+*@param t Les tables.
+*@param match Le match, ses scores sont mis a jour.
+*@return vide.
+*/
+void table_regulation(OutcomeTable *t, Match match) {
+    int d = rating_diff(match->team1, match->team2) - t->min_diff;
+    uint32_t o = alias_draw(&t->regulation[d], &match->rng);
+
+    match->score1 += o >> 16;
+    match->score2 += o & 0xffff;
+}
+
+/**
+*@brief Joue un match en O(1) : le score du temps reglementaire est tire dans la table de l'ecart de classement, puis, en cas d'egalite, le resultat des tirs au but. Aucun but n'est publie dans le journal.
+*@param t Les tables.
+*@param match Le match, ses scores sont mis a jour.
+*@return Le numero de l'equipe gagnante.
+*/
+int table_match(OutcomeTable *t, Match match) {
+    int d = rating_diff(match->team1, match->team2) - t->min_diff;
+
+    table_regulation(t, match);
+    if (match->score1 == match->score2) {
+        uint32_t o = alias_draw(&t->penalties[d], &match->rng);
+        match->score1 += o >> 16;
+        match->score2 += o & 0xffff;
+    }
+    return match->score1 > match->score2 ? match->team1 : match->team2;
+}
+
+/**
+*@brief Libere les tables.
+*@param t Les tables.
+*@return vide.
+*/
+void table_free(OutcomeTable *t) {
+    for (int d = 0; d <= t->max_diff - t->min_diff; d++) {
+        AliasTable *tables[2] = {&t->regulation[d], &t->penalties[d]};
+        for (int k = 0; k < 2; k++) {
+            free(tables[k]->threshold);
+            free(tables[k]->alias);
+            free(tables[k]->outcome);
+        }
+    }
+    free(t->regulation);
+    free(t->penalties);
+}
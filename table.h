@@ -0,0 +1,43 @@
+#ifndef OS_TABLE_H
+#define OS_TABLE_H
+
+#include "fonctions.h"
+
+/**
+ *@brief Taille maximale des tables precalculees, en nombre d'issues (au-dela, le moteur minute est utilise)
+*/
+#define TABLE_MAX_OUTCOMES (1 << 24)
+
+/**
+ *@brief Table d'alias de Walker : une issue est tiree en O(1) avec un seul tirage de 64 bits (case uniforme,
+ * puis on garde la case si la partie basse est sous threshold, sinon on prend son alias).
+ * Chaque issue est un couple de scores code (score1 << 16) | score2.
+*/
+typedef struct AliasTable{
+    int count;
+    uint32_t *threshold;
+    uint32_t *alias;
+    uint32_t *outcome;
+}AliasTable;
+
+/**
+ *@brief Distributions precalculees des resultats, pour chaque ecart de classement present entre min_diff et max_diff :
+ * score du temps reglementaire (loi multinomiale sur match_duration minutes), et buts d'une seance de tirs au but.
+ * Les chances d'un match ne dependant que de l'ecart de classement (odds_from_diff), une table sert a toutes les paires de meme ecart.
+*/
+typedef struct OutcomeTable{
+    int min_diff;
+    int max_diff;
+    AliasTable *regulation; // indice diff - min_diff
+    AliasTable *penalties;
+}OutcomeTable;
+
+extern OutcomeTable outcomes;
+
+int table_build(OutcomeTable *t);
+void table_regulation(OutcomeTable *t, Match match);
+int table_match(OutcomeTable *t, Match match);
+double table_win_probability(const Odds *odds);
+void table_free(OutcomeTable *t);
+
+#endif
@@ -0,0 +1,153 @@
+#include "fonctions.h"
+#include "bracket.h"
+/**
+ * @file test_engines.c
+ * @brief Test des moteurs de temps reglementaire (make test)
+ * Simule N matchs avec le moteur de reference (minute) et N matchs avec le moteur a saut d'evenements (skip),
+ * sur des flux aleatoires independants tires d'une graine fixe, puis verifie que les deux moteurs donnent
+ * la meme loi des scores : test du khi-deux a deux echantillons sur les scores du temps reglementaire et sur
+ * les scores finaux (tirs au but compris), et ecart des moyennes de buts inferieur a 4 erreurs types.
+*/
+
+/**
+ *@brief Variables globales du simulateur, definies ici comme dans main.c
+*/
+int match_duration = DURATION;
+int num_teams;
+TeamTable teams;
+int * teams_remaining;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+Bracket bracket;
+Options options;
+
+/**
+ *@brief Buts comptes par equipe dans les histogrammes : au-dela, le score est range dans la derniere case
+*/
+#define TEST_GOALS 12
+
+/**
+ *@brief Quantile de la loi normale au seuil du test (p = 0.001)
+*/
+#define TEST_Z 3.09
+
+/**
+ *@brief Effectif minimal d'une case du khi-deux : les cases plus rares sont regroupees
+*/
+#define TEST_MIN_CELL 10
+
+/**
+ *@brief Echantillon d'un moteur : histogrammes des scores et somme des buts
+*/
+typedef struct Sample{
+    long regulation[TEST_GOALS][TEST_GOALS];
+    long final[TEST_GOALS][TEST_GOALS];
+    double goals;       // somme des buts du temps reglementaire
+    double squares;     // somme de leurs carres
+}Sample;
+
+/**
+*@brief Simule n matchs avec un moteur, chacun sur le flux (graine, first + i, 0).
+*@param s L'echantillon a remplir.
+*@param engine Le moteur (ENGINE_MINUTE ou ENGINE_SKIP).
+*@param seed La graine.
+*@param first Le numero du premier flux.
+*@param n Le nombre de matchs.
+*@return vide.
+*/
+static void sample_engine(Sample *s, int engine, uint64_t seed, long first, long n) {
+    struct Match match;
+
+    memset(s, 0, sizeof(Sample));
+    options.engine = engine;
+    for (long i = 0; i < n; i++) {
+        match.team1 = 0;
+        match.team2 = 1;
+        match.score1 = 0;
+        match.score2 = 0;
+        match.tour = 1;
+        rng_seed(&match.rng, seed, first + i, 0);
+        run_regulation(&match, 0);
+        int g = match.score1 + match.score2;
+        s->goals += g;
+        s->squares += (double) g * g;
+        s->regulation[match.score1 < TEST_GOALS ? match.score1 : TEST_GOALS - 1][match.score2 < TEST_GOALS ? match.score2 : TEST_GOALS - 1]++;
+        penalty_shootout(&match, 0);
+        s->final[match.score1 < TEST_GOALS ? match.score1 : TEST_GOALS - 1][match.score2 < TEST_GOALS ? match.score2 : TEST_GOALS - 1]++;
+    }
+}
+
+/**
+*@brief Test du khi-deux a deux echantillons de meme taille sur deux histogrammes, les cases de moins de TEST_MIN_CELL matchs etant regroupees en une seule.
+*@param name Le nom de l'histogramme, pour l'affichage.
+*@param a L'histogramme du premier moteur.
+*@param b L'histogramme du second moteur.
+*@return 1 si les deux lois sont compatibles au seuil p = 0.001, 0 sinon.
+*/
+static int chi_square(const char *name, long a[TEST_GOALS][TEST_GOALS], long b[TEST_GOALS][TEST_GOALS]) {
+    double chi = 0;
+    long rare_a = 0, rare_b = 0;
+    int cells = 0;
+
+    for (int i = 0; i < TEST_GOALS; i++) {
+        for (int j = 0; j < TEST_GOALS; j++) {
+            long sum = a[i][j] + b[i][j];
+            if (sum >= TEST_MIN_CELL) {
+                chi += (double) (a[i][j] - b[i][j]) * (a[i][j] - b[i][j]) / sum;
+                cells++;
+            } else {
+                rare_a += a[i][j];
+                rare_b += b[i][j];
+            }
+        }
+    }
+    if (rare_a + rare_b > 0) {
+        chi += (double) (rare_a - rare_b) * (rare_a - rare_b) / (rare_a + rare_b);
+        cells++;
+    }
+    //Valeur critique du khi-deux a df degres de liberte (approximation de Wilson-Hilferty)
+    int df = cells - 1;
+    double h = 2.0 / (9.0 * df);
+    double critical = df * pow(1 - h + TEST_Z * sqrt(h), 3);
+    int ok = chi <= critical;
+    printf("%-14s khi-deux %.1f pour %d degres de liberte (seuil %.1f) : %s\n", name, chi, df, critical, ok ? "OK" : "ECHEC");
+    return ok;
+}
+
+/**
+ *@brief Fonction principale du test
+ *@param argc Nombre d'arguments passés au programme
+ *@param argv Nombre de matchs par moteur (1000000 par defaut) et graine (42 par defaut)
+ *@return EXIT_SUCCESS si les moteurs concordent, EXIT_FAILURE sinon
+*/
+int main(int argc, char *argv[])
+{
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 0) : 42;
+    Sample *minute = (Sample*) malloc(sizeof(Sample));
+    Sample *skip = (Sample*) malloc(sizeof(Sample));
+    int ok = 1;
+
+    if (n < 1000) {
+        printf("Usage : %s [matchs >= 1000] [graine]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    options.quiet = 2;
+    sample_engine(minute, ENGINE_MINUTE, seed, 0, n);
+    sample_engine(skip, ENGINE_SKIP, seed, n, n);
+    printf("Moteurs minute et skip, %ld matchs chacun, graine %llu\n", n, (unsigned long long) seed);
+    ok &= chi_square("reglementaire", minute->regulation, skip->regulation);
+    ok &= chi_square("final", minute->final, skip->final);
+
+    //Moyennes des buts du temps reglementaire : ecart inferieur a 4 erreurs types
+    double mean_m = minute->goals / n;
+    double mean_s = skip->goals / n;
+    double se = sqrt((minute->squares / n - mean_m * mean_m) / n + (skip->squares / n - mean_s * mean_s) / n);
+    int close = fabs(mean_m - mean_s) <= 4 * se;
+    printf("%-14s %.4f (minute) contre %.4f (skip), ecart %.4f pour une erreur type de %.4f : %s\n", "buts moyens",
+           mean_m, mean_s, fabs(mean_m - mean_s), se, close ? "OK" : "ECHEC");
+    ok &= close;
+
+    free(minute);
+    free(skip);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,43 @@
+#!/bin/sh
+# Test du mode temps reel (make test) : un tableau de 64 equipes joue avec --live=1 sur plusieurs workers.
+# Pour chaque match, les lignes doivent sortir dans l'ordre : DEBUT, buts aux minutes croissantes, FIN.
+# Usage : ./test_live.sh [executable] [threads]
+
+EXEC=${1:-./my_program}
+THREADS=${2:-4}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+awk 'BEGIN { print 90; for (i = 1; i <= 64; i++) print "Equipe" i }' > "$DIR/equipes.txt"
+echo 1 | "$EXEC" --live=1 --threads "$THREADS" --seed 7 --output "$DIR/matchs.txt" "$DIR/equipes.txt" > "$DIR/sortie.txt"
+
+awk '
+    # Les matchs sont reperes par leurs deux equipes, qui ne se rencontrent qu une fois
+    function fail(msg) { printf "ligne %d : %s : %s\n", NR, msg, $0; errors++ }
+    $1 == "DEBUT" {
+        key = $2 " " $6
+        if (key in state) fail("match deja commence")
+        state[key] = 1; last[key] = 0; started++
+        next
+    }
+    $1 ~ /^\([0-9]+.\)$/ {
+        minute = substr($1, 2) + 0
+        key = $2 " " $6
+        if (state[key] != 1) fail("but hors d un match en cours")
+        else if (minute < last[key]) fail("minute " minute " apres la minute " last[key])
+        last[key] = minute; goals++
+        next
+    }
+    $1 == "FIN" {
+        key = $2 " " $6
+        gsub(/\*/, "", key)
+        if (state[key] != 1) fail("fin d un match qui n est pas en cours")
+        state[key] = 2; finished++
+        next
+    }
+    END {
+        if (started != 63 || finished != 63) { printf "%d matchs commences et %d termines au lieu de 63\n", started, finished; errors++ }
+        printf "Temps reel : %d matchs, %d buts, %d erreur(s) d ordre : %s\n", finished, goals, errors, errors ? "ECHEC" : "OK"
+        exit errors ? 1 : 0
+    }
+' "$DIR/sortie.txt"